@@ -1,14 +1,28 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
 #include <compare>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <memory_resource>
 #include <ostream>
 #include <span>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 // Implements the operations of the Galois Field GF(256) using the reducing
 // polynomial x^8 + x^4 + x^3 + x + 1.
 //
@@ -183,6 +197,701 @@ class GF {
       199, 82,  246};
 };
 
+namespace gf256_internal {
+
+// Gets the byte representation of an array of elements.
+inline GF::Bits* bits(GF* const p) noexcept {
+  return reinterpret_cast<GF::Bits*>(p);
+}
+
+inline const GF::Bits* bits(const GF* const p) noexcept {
+  return reinterpret_cast<const GF::Bits*>(p);
+}
+
+inline GF::Bits* bits(std::byte* const p) noexcept {
+  return reinterpret_cast<GF::Bits*>(p);
+}
+
+inline const GF::Bits* bits(const std::byte* const p) noexcept {
+  return reinterpret_cast<const GF::Bits*>(p);
+}
+
+// Products of a constant element `c` by all the possible nibbles. For any byte
+// `y`, c * GF(y) == GF(lo[y & 0xF] ^ hi[y >> 4]).
+//
+// This split representation is what the SIMD region kernels need, since a
+// 16-entry table fits in a single vector register.
+struct MulTable {
+  alignas(16) GF::Bits lo[16];
+  alignas(16) GF::Bits hi[16];
+
+  explicit MulTable(const GF c) noexcept {
+    for (int i = 0; i < 16; ++i) {
+      lo[i] = (c * GF(GF::Bits(i))).bits;
+      hi[i] = (c * GF(GF::Bits(i << 4))).bits;
+    }
+  }
+};
+
+// Computes dst[i] = c * src[i] (or dst[i] += c * src[i] if `add` is true) for i
+// in [0..n), where `t` is the MulTable of `c`.
+template <bool add>
+inline void mul_region(GF::Bits* const dst, const GF::Bits* const src,
+                       const std::size_t n, const MulTable& t) noexcept {
+  std::size_t i = 0;
+
+#if defined(__AVX2__)
+  {
+    const __m256i lo = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(t.lo)));
+    const __m256i hi = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(t.hi)));
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    for (; i + 32 <= n; i += 32) {
+      const __m256i s =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+      __m256i p = _mm256_xor_si256(
+          _mm256_shuffle_epi8(lo, _mm256_and_si256(s, mask)),
+          _mm256_shuffle_epi8(
+              hi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask)));
+      __m256i* const d = reinterpret_cast<__m256i*>(dst + i);
+      if (add) p = _mm256_xor_si256(p, _mm256_loadu_si256(d));
+      _mm256_storeu_si256(d, p);
+    }
+  }
+#endif
+
+#if defined(__SSSE3__)
+  {
+    const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(t.lo));
+    const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(t.hi));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    for (; i + 16 <= n; i += 16) {
+      const __m128i s =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      __m128i p = _mm_xor_si128(
+          _mm_shuffle_epi8(lo, _mm_and_si128(s, mask)),
+          _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(s, 4), mask)));
+      __m128i* const d = reinterpret_cast<__m128i*>(dst + i);
+      if (add) p = _mm_xor_si128(p, _mm_loadu_si128(d));
+      _mm_storeu_si128(d, p);
+    }
+  }
+#endif
+
+  for (; i < n; ++i) {
+    const GF::Bits p = t.lo[src[i] & 0xF] ^ t.hi[src[i] >> 4];
+    dst[i] = add ? dst[i] ^ p : p;
+  }
+}
+
+// Number of destination bytes processed at once by `dot`. The destination tile
+// stays in the L1 cache while all the sources are accumulated into it.
+constexpr std::size_t tile_size = 4096;
+
+// Computes dst[j] = sum(cs[i] * srcs[i][j] for i in [0..k)) for j in [0..n),
+// or adds this sum to dst[j] if `add` is true. The multiplication tables are
+// allocated from `resource`.
+template <bool add = false>
+inline void dot(GF::Bits* const dst, const std::size_t n, const GF* const cs,
+                const GF::Bits* const* const srcs, const std::size_t k,
+                std::pmr::memory_resource* const resource =
+                    std::pmr::get_default_resource()) {
+  std::pmr::vector<MulTable> tables(resource);
+  tables.reserve(k);
+  for (std::size_t i = 0; i < k; ++i) tables.emplace_back(cs[i]);
+
+  for (std::size_t j = 0; j < n; j += tile_size) {
+    const std::size_t len = std::min(tile_size, n - j);
+    if (!add) std::fill_n(dst + j, len, GF::Bits(0));
+    for (std::size_t i = 0; i < k; ++i) {
+      if (cs[i]) mul_region<true>(dst + j, srcs[i] + j, len, tables[i]);
+    }
+  }
+}
+
+}  // namespace gf256_internal
+
+// Multiplies the elements of `src` by `c` and stores the results in `dst`:
+// dst[i] = c * src[i] for i in [0..n).
+//
+// `dst` and `src` can be the same region.
+//
+// Precondition: dst.size() == src.size()
+inline void mul(std::span<GF> dst, GF c, std::span<const GF> src) noexcept {
+  assert(dst.size() == src.size());
+  using namespace gf256_internal;
+  mul_region<false>(bits(dst.data()), bits(src.data()), dst.size(),
+                    MulTable(c));
+}
+
+// Multiplies the elements of `src` by `c` and adds the results to `dst`:
+// dst[i] += c * src[i] for i in [0..n).
+//
+// Precondition: dst.size() == src.size()
+inline void mul_add(std::span<GF> dst, GF c, std::span<const GF> src) noexcept {
+  assert(dst.size() == src.size());
+  if (!c) return;
+  using namespace gf256_internal;
+  mul_region<true>(bits(dst.data()), bits(src.data()), dst.size(),
+                   MulTable(c));
+}
+
+// Adds the elements of `src` to `dst`: dst[i] += src[i] for i in [0..n).
+//
+// Precondition: dst.size() == src.size()
+inline void add(std::span<GF> dst, std::span<const GF> src) noexcept {
+  assert(dst.size() == src.size());
+  using namespace gf256_internal;
+  GF::Bits* const d = bits(dst.data());
+  const GF::Bits* const s = bits(src.data());
+  const std::size_t n = dst.size();
+  std::size_t i = 0;
+
+#if defined(__AVX2__)
+  for (; i + 32 <= n; i += 32) {
+    __m256i* const p = reinterpret_cast<__m256i*>(d + i);
+    _mm256_storeu_si256(
+        p, _mm256_xor_si256(_mm256_loadu_si256(p),
+                            _mm256_loadu_si256(
+                                reinterpret_cast<const __m256i*>(s + i))));
+  }
+#endif
+
+  for (; i < n; ++i) d[i] ^= s[i];
+}
+
+// Computes the linear combination of the `srcs` regions weighted by the `cs`
+// coefficients, and stores it in `dst`:
+// dst[j] = sum(cs[i] * srcs[i][j] for i in [0..k)) for j in [0..n).
+//
+// The destination is processed in cache-sized tiles, so that each destination
+// byte is written once to memory regardless of the number of sources.
+//
+// Precondition: cs.size() == srcs.size()
+// Precondition: srcs[i].size() == dst.size() for each i
+inline void dot(std::span<GF> dst, std::span<const GF> cs,
+                std::span<const std::span<const GF>> srcs) {
+  assert(cs.size() == srcs.size());
+  std::vector<const GF::Bits*> ptrs;
+  ptrs.reserve(srcs.size());
+  for (const std::span<const GF> src : srcs) {
+    assert(src.size() == dst.size());
+    ptrs.push_back(gf256_internal::bits(src.data()));
+  }
+
+  gf256_internal::dot(gf256_internal::bits(dst.data()), dst.size(), cs.data(),
+                      ptrs.data(), ptrs.size());
+}
+
+// Adds the linear combination of the `srcs` regions weighted by the `cs`
+// coefficients to `dst`:
+// dst[j] += sum(cs[i] * srcs[i][j] for i in [0..k)) for j in [0..n).
+//
+// Precondition: cs.size() == srcs.size()
+// Precondition: srcs[i].size() == dst.size() for each i
+inline void dot_add(std::span<GF> dst, std::span<const GF> cs,
+                    std::span<const std::span<const GF>> srcs) {
+  assert(cs.size() == srcs.size());
+  std::vector<const GF::Bits*> ptrs;
+  ptrs.reserve(srcs.size());
+  for (const std::span<const GF> src : srcs) {
+    assert(src.size() == dst.size());
+    ptrs.push_back(gf256_internal::bits(src.data()));
+  }
+
+  gf256_internal::dot<true>(gf256_internal::bits(dst.data()), dst.size(),
+                            cs.data(), ptrs.data(), ptrs.size());
+}
+
+// Lazy linear combination of `N` regions of the same size with constant
+// coefficients: sum(cs[i] * srcs[i] for i in [0..N)).
+//
+// Expressions such as `a * x + b * y + c * z` are flattened at compile time
+// into a single combination. Assigning them to a `region` evaluates them in a
+// single pass of the `dot` kernel, without any temporary region.
+template <std::size_t N>
+struct RegionExpr {
+  std::array<GF, N> cs;
+  std::array<std::span<const GF>, N> srcs;
+
+  // Number of values of the regions.
+  std::size_t size() const noexcept { return srcs[0].size(); }
+};
+
+inline RegionExpr<1> operator*(GF c, std::span<const GF> x) noexcept {
+  return {{c}, {x}};
+}
+
+inline RegionExpr<1> operator*(std::span<const GF> x, GF c) noexcept {
+  return {{c}, {x}};
+}
+
+template <std::size_t N>
+RegionExpr<N> operator*(GF c, RegionExpr<N> e) noexcept {
+  for (GF& ci : e.cs) ci *= c;
+  return e;
+}
+
+template <std::size_t N>
+RegionExpr<N> operator*(RegionExpr<N> e, GF c) noexcept {
+  return c * e;
+}
+
+// Precondition: a.size() == b.size()
+template <std::size_t N, std::size_t M>
+RegionExpr<N + M> operator+(const RegionExpr<N>& a,
+                            const RegionExpr<M>& b) noexcept {
+  assert(a.size() == b.size());
+  RegionExpr<N + M> r;
+  std::copy(a.cs.begin(), a.cs.end(), r.cs.begin());
+  std::copy(b.cs.begin(), b.cs.end(), r.cs.begin() + N);
+  std::copy(a.srcs.begin(), a.srcs.end(), r.srcs.begin());
+  std::copy(b.srcs.begin(), b.srcs.end(), r.srcs.begin() + N);
+  return r;
+}
+
+// Same as the addition in GF(256).
+template <std::size_t N, std::size_t M>
+RegionExpr<N + M> operator-(const RegionExpr<N>& a,
+                            const RegionExpr<M>& b) noexcept {
+  return a + b;
+}
+
+// Destination of region expressions, created by the `region` function below.
+class Region {
+ public:
+  explicit Region(std::span<GF> dst) noexcept : dst_(dst) {}
+
+  // Precondition: e.size() == dst.size()
+  template <std::size_t N>
+  Region& operator=(const RegionExpr<N>& e) {
+    eval<false>(e);
+    return *this;
+  }
+
+  // Precondition: e.size() == dst.size()
+  template <std::size_t N>
+  Region& operator+=(const RegionExpr<N>& e) {
+    eval<true>(e);
+    return *this;
+  }
+
+  // Same as the addition in GF(256).
+  template <std::size_t N>
+  Region& operator-=(const RegionExpr<N>& e) {
+    return *this += e;
+  }
+
+ private:
+  template <bool add, std::size_t N>
+  void eval(const RegionExpr<N>& e) const {
+    using namespace gf256_internal;
+    assert(e.size() == dst_.size());
+
+    // The first source is reserved for `dst` itself. If it is also a source of
+    // the expression, it is read before being written in each tile of the
+    // kernel: dst = c * dst + e' is computed as dst += (c + 1) * dst + e'.
+    GF::Bits* const d = bits(dst_.data());
+    std::array<GF, N + 1> cs = {};
+    std::array<const GF::Bits*, N + 1> srcs = {d};
+    bool aliased = false;
+    for (std::size_t i = 0; i < N; ++i) {
+      srcs[i + 1] = bits(e.srcs[i].data());
+      if (srcs[i + 1] == d) {
+        aliased = true;
+        cs[0] += e.cs[i];
+      } else {
+        cs[i + 1] = e.cs[i];
+      }
+    }
+
+    if (!aliased) {
+      gf256_internal::dot<add>(d, dst_.size(), cs.data() + 1, srcs.data() + 1,
+                               N);
+      return;
+    }
+
+    if (!add) cs[0] += GF(1);
+    gf256_internal::dot<true>(d, dst_.size(), cs.data(), srcs.data(), N + 1);
+  }
+
+  std::span<GF> dst_;
+};
+
+// Returns the destination region `dst` of an expression: `region(dst) = a * x +
+// b * y` stores the combination in `dst`, and `region(dst) += a * x + b * y`
+// adds it to `dst`.
+//
+// `dst` can be one of the sources of the expression, such as in
+// `region(x) = a * x + b * y`, but must not partially overlap any of them.
+inline Region region(std::span<GF> dst) noexcept { return Region(dst); }
+
+// Computes the Lagrange coefficients needed to interpolate polynomials defined
+// by their values at `xs`, and to evaluate them at `dest_x`.
+//
+// Let's `n` be the number of given `xs`. The result `cs` contains `n`
+// coefficients such that, for any polynomial `p` of degree `n - 1` or less:
+// p(dest_x) == sum(cs[i] * p(xs[i]) for i in [0..n))
+//
+// If `dest_x` is one of the `xs`, the result is the corresponding unit vector.
+//
+// The time complexity of this method is O(n*n).
+//
+// Precondition: xs.size() >= 2
+// Precondition: xs[i] != xs[j] for i != j
+// Precondition: cs.size() == xs.size()
+inline void lagrange_coefficients(std::span<const GF> xs, GF dest_x,
+                                  std::span<GF> cs) {
+  if (xs.size() < 2) {
+    throw std::runtime_error("Too few shares");
+  }
+
+  assert(cs.size() == xs.size());
+  std::fill(cs.begin(), cs.end(), GF(0));
+
+  // Logarithm of the product of (x - dest_x) for x in xs.
+  int a = 0;
+
+  for (std::size_t i = 0; i < xs.size(); ++i) {
+    const GF d = xs[i] - dest_x;
+    if (!d) {
+      cs[i] = GF(1);
+      return;
+    }
+
+    a += log(d);
+  }
+
+  for (std::size_t i = 0; i < xs.size(); ++i) {
+    // Logarithm of the Lagrange basis polynomial evaluated at dest_x.
+    int b = a - log(xs[i] - dest_x);
+    for (std::size_t j = 0; j < xs.size(); ++j) {
+      if (i != j) {
+        const GF d = xs[i] - xs[j];
+        if (!d) {
+          throw std::runtime_error(
+              "All the shares must have distinct x values");
+        }
+        b -= log(d);
+      }
+    }
+
+    cs[i] = GF::exp(b);
+  }
+}
+
+// Returns the Lagrange coefficients computed by the function above.
+//
+// Precondition: xs.size() >= 2
+// Precondition: xs[i] != xs[j] for i != j
+inline std::vector<GF> lagrange_coefficients(std::span<const GF> xs,
+                                             GF dest_x) {
+  std::vector<GF> cs(xs.size());
+  lagrange_coefficients(xs, dest_x, cs);
+  return cs;
+}
+
+// Barycentric weights of a set of `x` values, computed once in O(n*n), which
+// then give the Lagrange coefficients for any `dest_x` in O(n). This makes
+// interpolating the same shares at many destinations cheap.
+//
+// The weight of xs[i] is w[i] = 1 / product(xs[i] - xs[j] for j != i), and the
+// Lagrange coefficients for `dest_x` are:
+// cs[i] = w[i] / (dest_x - xs[i]) * product(dest_x - xs[j] for all j)
+class BarycentricWeights {
+ public:
+  // Precondition: xs.size() >= 2
+  // Precondition: xs[i] != xs[j] for i != j
+  explicit BarycentricWeights(std::span<const GF> xs)
+      : xs_(xs.begin(), xs.end()), log_ws_(xs.size()) {
+    if (xs.size() < 2) {
+      throw std::runtime_error("Too few shares");
+    }
+
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+      int b = 0;
+      for (std::size_t j = 0; j < xs.size(); ++j) {
+        if (i != j) {
+          const GF d = xs[i] - xs[j];
+          if (!d) {
+            throw std::runtime_error(
+                "All the shares must have distinct x values");
+          }
+          b -= log(d);
+        }
+      }
+
+      log_ws_[i] = b;
+    }
+  }
+
+  std::span<const GF> xs() const noexcept { return xs_; }
+
+  // Computes the Lagrange coefficients needed to evaluate the polynomials
+  // defined by their values at `xs` at `dest_x`, like `lagrange_coefficients`,
+  // and stores them in `cs`.
+  //
+  // The time complexity of this method is O(n).
+  //
+  // Precondition: cs.size() == xs().size()
+  void coefficients(GF dest_x, std::span<GF> cs) const noexcept {
+    assert(cs.size() == xs_.size());
+
+    // Logarithm of the product of (dest_x - x) for x in xs.
+    int a = 0;
+    for (std::size_t i = 0; i < xs_.size(); ++i) {
+      const GF d = dest_x - xs_[i];
+      if (!d) {
+        std::fill(cs.begin(), cs.end(), GF(0));
+        cs[i] = GF(1);
+        return;
+      }
+
+      a += log(d);
+    }
+
+    for (std::size_t i = 0; i < xs_.size(); ++i) {
+      cs[i] = GF::exp(a + log_ws_[i] - log(dest_x - xs_[i]));
+    }
+  }
+
+  std::vector<GF> coefficients(GF dest_x) const {
+    std::vector<GF> cs(xs_.size());
+    coefficients(dest_x, cs);
+    return cs;
+  }
+
+ private:
+  std::vector<GF> xs_;
+
+  // Logarithms of the weights.
+  std::vector<int> log_ws_;
+};
+
+// Computes the Lagrange coefficient of the single share with the `x` value `x`,
+// among the shares with the `xs` values, to interpolate them at `dest_x`. This
+// is the coefficient that `lagrange_coefficients(xs, dest_x)` gives for `x`,
+// computed in O(n) instead of O(n*n).
+//
+// This lets each share holder compute its own weighted contribution to a
+// reconstruction, see `to_contribution`.
+//
+// Precondition: xs.size() >= 2
+// Precondition: xs[i] != xs[j] for i != j
+// Precondition: x is one of the xs
+inline GF lagrange_weight(std::span<const GF> xs, GF x, GF dest_x) {
+  if (xs.size() < 2) {
+    throw std::runtime_error("Too few shares");
+  }
+
+  std::array<bool, 256> seen = {};
+  for (const GF xj : xs) {
+    if (seen[xj.bits]) {
+      throw std::runtime_error("All the shares must have distinct x values");
+    }
+
+    seen[xj.bits] = true;
+  }
+
+  if (!seen[x.bits]) {
+    throw std::runtime_error("The share is not one of the interpolated shares");
+  }
+
+  int b = 0;
+  for (const GF xj : xs) {
+    if (xj == x) continue;
+
+    const GF d = xj - dest_x;
+    if (!d) return GF(0);
+    b += log(d) - log(x - xj);
+  }
+
+  return x == dest_x ? GF(1) : GF::exp(b);
+}
+
+namespace gf256_internal {
+
+// Uppercase hexadecimal digits.
+inline constexpr char hex_digits[] = "0123456789ABCDEF";
+
+// Values of the hexadecimal digits, or 0xFF for other characters. Both
+// uppercase and lowercase digits are accepted.
+constexpr std::array<std::uint8_t, 256> make_hex_values() noexcept {
+  std::array<std::uint8_t, 256> values = {};
+  for (int c = 0; c < 256; ++c) {
+    values[c] = c >= '0' && c <= '9'   ? c - '0'
+                : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                                       : 0xFF;
+  }
+  return values;
+}
+
+inline constexpr std::array<std::uint8_t, 256> hex_values = make_hex_values();
+
+// Shuffle masks mapping 16 values to the 48 characters of their hexadecimal
+// representation "HL HL ... HL ", made of three blocks of 16 characters. For
+// each block `k`, `hi[k]` and `lo[k]` select the value whose high or low digit
+// goes at each position (0x80 selects nothing), and `sep` has the separators.
+// Conversely, `from_hi[k]`, `from_lo[k]` and `from_sep[k]` select the
+// characters of block `k` holding the high digit, low digit and separator of
+// each value.
+struct HexShuffle {
+  std::uint8_t hi[3][16] = {};
+  std::uint8_t lo[3][16] = {};
+  std::uint8_t sep[3][16] = {};
+  std::uint8_t from_hi[3][16] = {};
+  std::uint8_t from_lo[3][16] = {};
+  std::uint8_t from_sep[3][16] = {};
+};
+
+constexpr HexShuffle make_hex_shuffle() noexcept {
+  HexShuffle s;
+  for (int k = 0; k < 3; ++k) {
+    for (int t = 0; t < 16; ++t) {
+      const int p = 16 * k + t;
+      s.hi[k][t] = p % 3 == 0 ? p / 3 : 0x80;
+      s.lo[k][t] = p % 3 == 1 ? p / 3 : 0x80;
+      s.sep[k][t] = p % 3 == 2 ? ' ' : 0;
+
+      // Here `t` is the index of a value.
+      const int ph = 3 * t - 16 * k;
+      const int pl = ph + 1;
+      const int ps = ph + 2;
+      s.from_hi[k][t] = ph >= 0 && ph < 16 ? ph : 0x80;
+      s.from_lo[k][t] = pl >= 0 && pl < 16 ? pl : 0x80;
+      s.from_sep[k][t] = ps >= 0 && ps < 16 ? ps : 0x80;
+    }
+  }
+  return s;
+}
+
+inline constexpr HexShuffle hex_shuffle = make_hex_shuffle();
+
+#if defined(__SSSE3__)
+inline __m128i load(const std::uint8_t* const p) noexcept {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// Converts 16 hexadecimal digits to their values. Sets `valid` to zero if one
+// of the characters is not a hexadecimal digit.
+inline __m128i hex_to_values(const __m128i c, __m128i& valid) noexcept {
+  const __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+  const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+  const __m128i a = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)),
+                                 _mm_set1_epi8('a'));
+  const __m128i is_alpha =
+      _mm_cmpeq_epi8(_mm_min_epu8(a, _mm_set1_epi8(5)), a);
+  valid = _mm_and_si128(valid, _mm_or_si128(is_digit, is_alpha));
+  return _mm_or_si128(
+      _mm_and_si128(d, is_digit),
+      _mm_and_si128(_mm_add_epi8(a, _mm_set1_epi8(10)), is_alpha));
+}
+#endif
+
+}  // namespace gf256_internal
+
+// Size of the hexadecimal representation of `m` values separated by spaces.
+constexpr std::size_t hex_size(std::size_t m) noexcept {
+  return m ? 3 * m - 1 : 0;
+}
+
+// Writes the hexadecimal representation of `ys` to `out`. Each value is written
+// as two uppercase digits, and the values are separated by spaces.
+//
+// Precondition: out.size() == hex_size(ys.size())
+inline void to_hex(std::span<const GF> ys, std::span<char> out) noexcept {
+  using namespace gf256_internal;
+  assert(out.size() == hex_size(ys.size()));
+  const std::size_t m = ys.size();
+  const GF::Bits* const src = bits(ys.data());
+  char* dst = out.data();
+  std::size_t i = 0;
+
+#if defined(__SSSE3__)
+  // Each block of 16 values is followed by a separator, as long as it is not
+  // the last block.
+  const __m128i digits =
+      load(reinterpret_cast<const std::uint8_t*>(hex_digits));
+  const __m128i mask = _mm_set1_epi8(0x0F);
+  for (; i + 16 < m; i += 16, dst += 48) {
+    const __m128i v = load(src + i);
+    const __m128i hi = _mm_shuffle_epi8(
+        digits, _mm_and_si128(_mm_srli_epi64(v, 4), mask));
+    const __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, mask));
+    for (int k = 0; k < 3; ++k) {
+      const __m128i h = _mm_shuffle_epi8(hi, load(hex_shuffle.hi[k]));
+      const __m128i l = _mm_shuffle_epi8(lo, load(hex_shuffle.lo[k]));
+      const __m128i c =
+          _mm_or_si128(_mm_or_si128(h, l), load(hex_shuffle.sep[k]));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16 * k), c);
+    }
+  }
+#endif
+
+  for (; i < m; ++i) {
+    *dst++ = hex_digits[src[i] >> 4];
+    *dst++ = hex_digits[src[i] & 0xF];
+    if (i + 1 < m) *dst++ = ' ';
+  }
+}
+
+// Parses the hexadecimal representation of values separated by spaces, as
+// written by `to_hex`. Both uppercase and lowercase digits are accepted.
+//
+// Throws: std::runtime_error if `in` is malformed.
+inline std::vector<GF> from_hex(std::string_view in) {
+  using namespace gf256_internal;
+  if (!in.empty() && in.size() % 3 != 2) {
+    throw std::runtime_error("Malformed hexadecimal values");
+  }
+
+  const std::size_t m = (in.size() + 1) / 3;
+  std::vector<GF> ys(m);
+  GF::Bits* const dst = bits(ys.data());
+  const std::uint8_t* src = reinterpret_cast<const std::uint8_t*>(in.data());
+  std::size_t i = 0;
+
+#if defined(__SSSE3__)
+  // Each block of 16 values is followed by a separator, as long as it is not
+  // the last block.
+  for (; i + 16 < m; i += 16, src += 48) {
+    __m128i hi = _mm_setzero_si128();
+    __m128i lo = _mm_setzero_si128();
+    __m128i sep = _mm_setzero_si128();
+    for (int k = 0; k < 3; ++k) {
+      const __m128i c = load(src + 16 * k);
+      hi = _mm_or_si128(hi, _mm_shuffle_epi8(c, load(hex_shuffle.from_hi[k])));
+      lo = _mm_or_si128(lo, _mm_shuffle_epi8(c, load(hex_shuffle.from_lo[k])));
+      sep = _mm_or_si128(sep,
+                         _mm_shuffle_epi8(c, load(hex_shuffle.from_sep[k])));
+    }
+
+    __m128i valid = _mm_cmpeq_epi8(sep, _mm_set1_epi8(' '));
+    hi = hex_to_values(hi, valid);
+    lo = hex_to_values(lo, valid);
+    if (_mm_movemask_epi8(valid) != 0xFFFF) {
+      throw std::runtime_error("Malformed hexadecimal values");
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_or_si128(_mm_slli_epi16(hi, 4), lo));
+  }
+#endif
+
+  for (; i < m; ++i, src += 3) {
+    const std::uint8_t hi = hex_values[src[0]];
+    const std::uint8_t lo = hex_values[src[1]];
+    if ((hi | lo) > 0xF || (i + 1 < m && src[2] != ' ')) {
+      throw std::runtime_error("Malformed hexadecimal values");
+    }
+    dst[i] = (hi << 4) | lo;
+  }
+
+  return ys;
+}
+
 // Struct used as input and output of the `interpolate` function.
 struct Share {
   GF x;
@@ -190,17 +899,69 @@ struct Share {
 
   friend bool operator==(const Share& a, const Share& b) = default;
 
+  // Stream insertion operator.
+  // Prints the share as {x: XX, ys: [YY YY ... YY]} in hexadecimal.
   friend std::ostream& operator<<(std::ostream& out, const Share& s) {
     out << "{x: " << s.x << ", ys: [";
-    const char* sep = "";
-    for (const GF y : s.ys) {
-      out << sep << y;
-      sep = " ";
+
+    // Encode the values in pieces to limit the size of the buffer.
+    constexpr std::size_t piece_size = 1024;
+    char buf[1 + hex_size(piece_size)];
+    const std::span<const GF> ys = s.ys;
+    for (std::size_t i = 0; i < ys.size(); i += piece_size) {
+      const std::size_t len = std::min(piece_size, ys.size() - i);
+      std::size_t n = 0;
+      if (i) buf[n++] = ' ';
+      to_hex(ys.subspan(i, len), {buf + n, hex_size(len)});
+      out.write(buf, n + hex_size(len));
     }
+
     return out << "]}";
   }
+
+  // Stream extraction operator.
+  // Reads a share printed by the stream insertion operator. Sets the failbit
+  // of the stream if the share is malformed.
+  friend std::istream& operator>>(std::istream& in, Share& s);
 };
 
+// Parses a share printed by the stream insertion operator, such as
+// {x: 01, ys: [AB CD EF]}.
+//
+// Throws: std::runtime_error if `text` is malformed.
+inline Share parse_share(std::string_view text) {
+  constexpr std::string_view prefix = "{x: ";
+  constexpr std::string_view infix = ", ys: [";
+  constexpr std::string_view suffix = "]}";
+  constexpr std::size_t hex_start = prefix.size() + 2 + infix.size();
+
+  if (text.size() < hex_start + suffix.size() || !text.starts_with(prefix) ||
+      text.substr(prefix.size() + 2, infix.size()) != infix ||
+      !text.ends_with(suffix)) {
+    throw std::runtime_error("Malformed share");
+  }
+
+  const std::vector<GF> x = from_hex(text.substr(prefix.size(), 2));
+  Share s;
+  s.x = x.front();
+  s.ys = from_hex(
+      text.substr(hex_start, text.size() - hex_start - suffix.size()));
+  return s;
+}
+
+inline std::istream& operator>>(std::istream& in, Share& s) {
+  std::string text;
+  if (!std::getline(in >> std::ws, text, '}')) return in;
+
+  try {
+    s = parse_share(text += '}');
+  } catch (const std::runtime_error&) {
+    in.setstate(std::ios::failbit);
+  }
+
+  return in;
+}
+
 // Interpolates polynomials using the Lagrange polynomial method.
 //
 // The given `shares` define the polynomials to interpolate. There must be at
@@ -240,8 +1001,10 @@ inline Share interpolate(std::span<const Share> shares, GF dest_x) {
   // Number of y values of each share.
   const size_t m = shares.front().ys.size();
 
-  // Logarithm of the product of (s.x - dest_x) for s in shares.
-  int a = 0;
+  std::vector<GF> xs;
+  std::vector<std::span<const GF>> srcs;
+  xs.reserve(shares.size());
+  srcs.reserve(shares.size());
 
   for (const Share& s : shares) {
     if (s.ys.size() != m) {
@@ -249,38 +1012,1514 @@ inline Share interpolate(std::span<const Share> shares, GF dest_x) {
           "All the shares must have the same number of y values");
     }
 
-    const GF d = s.x - dest_x;
-    if (!d) {
-      return s;
-    }
-
-    a += log(d);
+    xs.push_back(s.x);
+    srcs.push_back(s.ys);
   }
 
+  const std::vector<GF> cs = lagrange_coefficients(xs, dest_x);
+
   Share r;
   r.x = dest_x;
   r.ys.resize(m);
+  dot(r.ys, cs, srcs);
+  return r;
+}
 
-  for (const Share& s : shares) {
-    // Logarithm of the Lagrange basis polynomial evaluated at dest_x.
-    int b = a - log(s.x - dest_x);
-    for (const Share& t : shares) {
-      if (&s != &t) {
-        const GF d = s.x - t.x;
-        if (!d) {
-          throw std::runtime_error(
-              "All the shares must have distinct x values");
-        }
-        b -= log(d);
-      }
-    }
+// Share whose `y` values are allocated from a polymorphic memory resource,
+// such as a std::pmr::monotonic_buffer_resource holding all the shares of a
+// batch, which are then released at once with the resource.
+struct PmrShare {
+  GF x;
+  std::pmr::vector<GF> ys;
 
-    for (size_t i = 0; i < m; ++i) {
-      if (const GF y = s.ys[i]) {
-        r.ys[i] += GF::exp(b + log(y));
-      }
-    }
+  friend bool operator==(const PmrShare& a, const PmrShare& b) = default;
+};
+
+// Interpolates shares like the function above, but allocates the resulting
+// share and all the temporary buffers from `resource`.
+//
+// Precondition: shares.size() >= 2
+// Precondition: shares[i].x != shares[j].x for i != j
+// Precondition: shares[i].ys.size() == shares[j].ys.size() for i != j
+inline PmrShare interpolate(std::span<const PmrShare> shares, GF dest_x,
+                            std::pmr::memory_resource* resource) {
+  if (shares.size() < 2) {
+    throw std::runtime_error("Too few shares");
   }
 
-  return r;
+  const size_t m = shares.front().ys.size();
+  std::pmr::vector<GF> xs(resource);
+  std::pmr::vector<const GF::Bits*> srcs(resource);
+  xs.reserve(shares.size());
+  srcs.reserve(shares.size());
+
+  for (const PmrShare& s : shares) {
+    if (s.ys.size() != m) {
+      throw std::runtime_error(
+          "All the shares must have the same number of y values");
+    }
+
+    xs.push_back(s.x);
+    srcs.push_back(gf256_internal::bits(s.ys.data()));
+  }
+
+  std::pmr::vector<GF> cs(xs.size(), resource);
+  lagrange_coefficients(xs, dest_x, cs);
+
+  PmrShare r{dest_x, std::pmr::vector<GF>(m, resource)};
+  gf256_internal::dot(gf256_internal::bits(r.ys.data()), m, cs.data(),
+                      srcs.data(), srcs.size(), resource);
+  return r;
+}
+
+// Turns a share into its contribution to the interpolation of the shares with
+// the `xs` values at `dest_x`, by multiplying its `y` values in place by its
+// Lagrange weight.
+//
+// Since the interpolation is linear, the interpolated share is the sum of the
+// contributions of all the shares, which can be added with `combine` in any
+// order. Each share holder can thus send a single share-sized contribution,
+// and the contributions can be summed along a chain or a tree of nodes.
+//
+// Precondition: xs.size() >= 2
+// Precondition: xs[i] != xs[j] for i != j
+// Precondition: share.x is one of the xs
+inline void to_contribution(Share& share, std::span<const GF> xs, GF dest_x) {
+  mul(share.ys, lagrange_weight(xs, share.x, dest_x), share.ys);
+  share.x = dest_x;
+}
+
+// Adds a contribution, or a sum of contributions, to the partial sum `sum`.
+//
+// Precondition: sum.x == contribution.x
+// Precondition: sum.ys.size() == contribution.ys.size()
+inline void combine(Share& sum, const Share& contribution) {
+  if (sum.x != contribution.x) {
+    throw std::runtime_error("Contributions to different x values");
+  }
+
+  if (sum.ys.size() != contribution.ys.size()) {
+    throw std::runtime_error(
+        "All the shares must have the same number of y values");
+  }
+
+  add(sum.ys, contribution.ys);
+}
+
+// Incremental interpolator absorbing shares one at a time, for instance as
+// they arrive from the network.
+//
+// The interpolated polynomials are kept in Newton form:
+// p(x) = c[0] + c[1]*(x - xs[0]) + ... + c[k-1]*(x - xs[0])*...*(x - xs[k-2])
+// where each coefficient `c[i]` is a vector of `m` values. Adding a share only
+// computes its new coefficient, with a single pass of the `dot` kernel over the
+// previous ones, and updates the value at `dest_x`. The interpolated share is
+// thus ready as soon as the last share has been added, without knowing in
+// advance which shares will participate.
+class NewtonInterpolator {
+ public:
+  // Creates an interpolator evaluating the polynomials at `dest_x`.
+  explicit NewtonInterpolator(GF dest_x = GF(0)) { result_.x = dest_x; }
+
+  // Adds a share.
+  //
+  // The time complexity of this method is O(k*m), where `k` is the number of
+  // shares already added.
+  //
+  // Precondition: share.x is different from the `x` values already added
+  // Precondition: share.ys.size() is the same for all the added shares
+  void add(const Share& share) {
+    const std::size_t k = xs_.size();
+    if (k > 0 && share.ys.size() != result_.ys.size()) {
+      throw std::runtime_error(
+          "All the shares must have the same number of y values");
+    }
+
+    // The new coefficient is (y - p(x)) / w, where `p` is the current
+    // polynomial and `w` is the product of (x - xs[i]). Since p(x) is a
+    // linear combination of the previous coefficients, the new coefficient is
+    // a linear combination of the previous coefficients and of `y`.
+    std::vector<GF> weights(k + 1);
+    std::vector<std::span<const GF>> srcs(k + 1);
+    GF w(1);
+    for (std::size_t i = 0; i < k; ++i) {
+      weights[i] = w;
+      srcs[i] = cs_[i];
+      w *= share.x - xs_[i];
+    }
+
+    if (!w) {
+      throw std::runtime_error("All the shares must have distinct x values");
+    }
+
+    const GF inv = GF(1) / w;
+    for (std::size_t i = 0; i < k; ++i) weights[i] *= inv;
+    weights[k] = inv;
+    srcs[k] = share.ys;
+
+    std::vector<GF>& c = cs_.emplace_back(share.ys.size());
+    dot(c, weights, srcs);
+
+    // Value at `dest_x` of the new Newton basis polynomial.
+    GF b(1);
+    for (const GF x : xs_) b *= result_.x - x;
+
+    xs_.push_back(share.x);
+    if (k == 0) {
+      result_.ys = share.ys;
+    } else {
+      mul_add(result_.ys, b, c);
+    }
+  }
+
+  // Number of shares added.
+  std::size_t size() const noexcept { return xs_.size(); }
+
+  // Gets the share at `dest_x` interpolated from the shares added so far. It
+  // is the same as `interpolate(shares, dest_x)`.
+  const Share& result() const noexcept { return result_; }
+
+  // Evaluates the polynomials interpolated from the shares added so far at
+  // another `x` value.
+  //
+  // The time complexity of this method is O(k*m).
+  Share evaluate(GF x) const {
+    const std::size_t k = xs_.size();
+    std::vector<GF> weights(k);
+    std::vector<std::span<const GF>> srcs(k);
+    GF b(1);
+    for (std::size_t i = 0; i < k; ++i) {
+      weights[i] = b;
+      srcs[i] = cs_[i];
+      b *= x - xs_[i];
+    }
+
+    Share r;
+    r.x = x;
+    r.ys.resize(result_.ys.size());
+    dot(r.ys, weights, srcs);
+    return r;
+  }
+
+ private:
+  // The `x` values of the added shares.
+  std::vector<GF> xs_;
+
+  // The Newton coefficients.
+  std::vector<std::vector<GF>> cs_;
+
+  // The share at `dest_x`.
+  Share result_;
+};
+
+// Lagrange coefficients used by `split` to interpolate the shares with the
+// `x` values `k` to `n` from the secret at x = 0 and from the first `k - 1`
+// shares. They only depend on `k` and `n`, so a secret split piece by piece,
+// such as a file split window by window, can compute them once.
+class SplitCoefficients {
+ public:
+  // Precondition: 2 <= k <= n <= GF::max
+  SplitCoefficients(int k, int n) : k_(k), n_(n) {
+    if (k < 2) throw std::runtime_error("Threshold must be at least 2");
+    if (n < k) throw std::runtime_error("Fewer shares than threshold");
+    if (n > GF::max) throw std::runtime_error("Too many shares");
+
+    std::vector<GF> xs(k);
+    for (int i = 1; i < k; ++i) xs[i] = GF(i);
+
+    rows_.resize((n - k + 1) * k);
+    for (int i = k; i <= n; ++i) {
+      lagrange_coefficients(xs, GF(i),
+                            std::span(rows_).subspan((i - k) * k, k));
+    }
+  }
+
+  int k() const noexcept { return k_; }
+  int n() const noexcept { return n_; }
+
+  // Gets the coefficients of the secret and of the first `k - 1` shares giving
+  // the share with the `x` value `x`.
+  //
+  // Precondition: k <= x <= n
+  std::span<const GF> row(int x) const noexcept {
+    assert(k_ <= x && x <= n_);
+    return std::span(rows_).subspan((x - k_) * k_, k_);
+  }
+
+ private:
+  int k_;
+  int n_;
+  std::vector<GF> rows_;
+};
+
+// Splits a secret into shares using Shamir's secret sharing, like the function
+// below, with the coefficients precomputed for `cs.k()` and `cs.n()`.
+//
+// Precondition: shares.size() == cs.n()
+// Precondition: shares[i].size() == secret.size() for each i
+template <typename Random>
+void split(std::span<const GF> secret, const SplitCoefficients& cs,
+           std::span<const std::span<GF>> shares, Random&& random) {
+  const int k = cs.k();
+  const int n = cs.n();
+  if (shares.size() != std::size_t(n)) {
+    throw std::runtime_error("Number of shares does not match coefficients");
+  }
+
+  // The points at which the polynomials are known: the secret, and then the
+  // `k - 1` random shares.
+  std::vector<std::span<const GF>> srcs(k);
+  srcs[0] = secret;
+  for (int i = 1; i < k; ++i) {
+    random(shares[i - 1]);
+    srcs[i] = shares[i - 1];
+  }
+
+  for (int i = k; i <= n; ++i) dot(shares[i - 1], cs.row(i), srcs);
+}
+
+// Splits a secret into shares using Shamir's secret sharing, so that any `k`
+// shares are enough to reconstruct the secret by interpolating them at x = 0,
+// whereas fewer shares reveal nothing about the secret.
+//
+// The `y` values of the share with the `x` value `i + 1` are written to
+// `shares[i]`. The secret is the value at x = 0 of random polynomials of degree
+// `k - 1`. The first `k - 1` shares are drawn at random, and the others are
+// interpolated from them and from the secret.
+//
+// `random` is called with spans of elements to fill with random values. It
+// must be a cryptographically secure source for the sharing to be secure.
+//
+// Precondition: 2 <= k <= shares.size() <= GF::max
+// Precondition: shares[i].size() == secret.size() for each i
+template <typename Random>
+void split(std::span<const GF> secret, int k,
+           std::span<const std::span<GF>> shares, Random&& random) {
+  split(secret, SplitCoefficients(k, shares.size()), shares, random);
+}
+
+// Splits a secret into `n` shares with the `x` values 1 to `n`, so that any `k`
+// of them are enough to reconstruct the secret. See above.
+//
+// Precondition: 2 <= k <= n <= GF::max
+template <typename Random>
+std::vector<Share> split(std::span<const GF> secret, int k, int n,
+                         Random&& random) {
+  if (n < 0 || n > GF::max) throw std::runtime_error("Too many shares");
+
+  std::vector<Share> shares(n);
+  std::vector<std::span<GF>> ys;
+  for (int i = 0; i < n; ++i) {
+    shares[i].x = GF(i + 1);
+    shares[i].ys.resize(secret.size());
+    ys.push_back(shares[i].ys);
+  }
+
+  split(secret, k, ys, random);
+  return shares;
+}
+
+// Refreshes shares in place, so that they still define the same secret but
+// cannot be combined with the shares from before the refresh (proactive secret
+// sharing).
+//
+// A random sharing of zero is added to the shares: the values at the `xs` of
+// random polynomials `d` of degree `k - 1` with d(0) = 0. The shares are
+// processed in windows, for which the `k - 1` random coefficients of the
+// polynomials are drawn at once from `random`, and then added to each share in
+// a single pass of the `dot_add` kernel.
+//
+// `random` must be a cryptographically secure source for the refresh to be
+// secure.
+//
+// Precondition: 2 <= k
+// Precondition: xs.size() == ys.size()
+// Precondition: xs[i] != 0 for each i
+// Precondition: ys[i].size() == ys[j].size() for i != j
+template <typename Random>
+void refresh(std::span<const GF> xs, std::span<const std::span<GF>> ys, int k,
+             Random&& random) {
+  if (k < 2) throw std::runtime_error("Threshold must be at least 2");
+  if (xs.size() != ys.size()) {
+    throw std::runtime_error("As many x values as shares are needed");
+  }
+
+  if (ys.empty()) return;
+  const std::size_t m = ys.front().size();
+  for (std::size_t i = 0; i < xs.size(); ++i) {
+    if (!xs[i]) throw std::runtime_error("Shares cannot have a zero x value");
+    if (ys[i].size() != m) {
+      throw std::runtime_error(
+          "All the shares must have the same number of y values");
+    }
+  }
+
+  // Powers of the `xs`: powers[i][j] = xs[i]^(j + 1).
+  std::vector<std::vector<GF>> powers(xs.size());
+  for (std::size_t i = 0; i < xs.size(); ++i) {
+    GF p = xs[i];
+    for (int j = 1; j < k; ++j, p *= xs[i]) powers[i].push_back(p);
+  }
+
+  constexpr std::size_t piece_size = 16 * gf256_internal::tile_size;
+  const std::size_t w = std::min(piece_size, m);
+  std::vector<GF> coefficients((k - 1) * w);
+  std::vector<std::span<const GF>> srcs(k - 1);
+  for (std::size_t pos = 0; pos < m; pos += w) {
+    const std::size_t len = std::min(w, m - pos);
+    random(std::span(coefficients).first((k - 1) * len));
+    for (int j = 0; j < k - 1; ++j) {
+      srcs[j] = std::span(coefficients).subspan(j * len, len);
+    }
+
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+      dot_add(ys[i].subspan(pos, len), powers[i], srcs);
+    }
+  }
+}
+
+// Refreshes shares in place. See above.
+//
+// Precondition: 2 <= k
+// Precondition: shares[i].x != 0 for each i
+// Precondition: shares[i].ys.size() == shares[j].ys.size() for i != j
+template <typename Random>
+void refresh(std::span<Share> shares, int k, Random&& random) {
+  std::vector<GF> xs;
+  std::vector<std::span<GF>> ys;
+  for (Share& s : shares) {
+    xs.push_back(s.x);
+    ys.push_back(s.ys);
+  }
+
+  refresh(xs, ys, k, random);
+}
+
+// Reshares a secret from the given `shares` of a (k, n) sharing to new shares
+// with the given `xs` values, any `k` of which are enough to reconstruct it.
+//
+// The secret is never reconstructed. The first `k - 1` new shares are drawn at
+// random, and each other new share is a linear combination of the old shares
+// and of these random shares. The coefficients of these combinations compose
+// the interpolation of the secret with the evaluation of the new polynomials,
+// so that each new share is computed with a single pass of the `dot` kernel.
+//
+// The given `shares` must be enough to reconstruct the secret.
+//
+// Precondition: shares.size() >= 2
+// Precondition: shares[i].x != shares[j].x for i != j
+// Precondition: shares[i].ys.size() == shares[j].ys.size() for i != j
+// Precondition: 2 <= k <= xs.size()
+// Precondition: xs[i] != xs[j] for i != j
+// Precondition: xs[i] != 0 for each i
+template <typename Random>
+std::vector<Share> reshare(std::span<const Share> shares, int k,
+                           std::span<const GF> xs, Random&& random) {
+  if (shares.size() < 2) throw std::runtime_error("Too few shares");
+  if (k < 2) throw std::runtime_error("Threshold must be at least 2");
+  if (xs.size() < std::size_t(k)) {
+    throw std::runtime_error("Fewer shares than threshold");
+  }
+
+  std::array<bool, 256> seen = {};
+  for (const GF x : xs) {
+    if (!x) throw std::runtime_error("Shares cannot have a zero x value");
+    if (seen[x.bits]) {
+      throw std::runtime_error("All the shares must have distinct x values");
+    }
+
+    seen[x.bits] = true;
+  }
+
+  const std::size_t m = shares.front().ys.size();
+  std::vector<GF> old_xs;
+  for (const Share& s : shares) {
+    if (s.ys.size() != m) {
+      throw std::runtime_error(
+          "All the shares must have the same number of y values");
+    }
+
+    old_xs.push_back(s.x);
+  }
+
+  // Coefficients interpolating the secret from the old shares.
+  const std::vector<GF> lambdas = lagrange_coefficients(old_xs, GF(0));
+
+  // The new polynomials are known at x = 0 and at the `k - 1` first new `xs`.
+  std::vector<GF> points = {GF(0)};
+  points.insert(points.end(), xs.begin(), xs.begin() + (k - 1));
+
+  std::vector<Share> r(xs.size());
+  std::vector<std::span<const GF>> srcs;
+  for (const Share& s : shares) srcs.push_back(s.ys);
+  for (int i = 0; i < k - 1; ++i) {
+    r[i].x = xs[i];
+    r[i].ys.resize(m);
+    random(std::span(r[i].ys));
+    srcs.push_back(r[i].ys);
+  }
+
+  std::vector<GF> cs(srcs.size());
+  for (std::size_t i = k - 1; i < xs.size(); ++i) {
+    const std::vector<GF> ls = lagrange_coefficients(points, xs[i]);
+
+    for (std::size_t t = 0; t < shares.size(); ++t) {
+      cs[t] = ls[0] * lambdas[t];
+    }
+    std::copy(ls.begin() + 1, ls.end(), cs.begin() + shares.size());
+
+    r[i].x = xs[i];
+    r[i].ys.resize(m);
+    dot(r[i].ys, cs, srcs);
+  }
+
+  return r;
+}
+
+// Gets the `x` value at which the block `i` of a packed secret is embedded by
+// `split_packed`.
+inline GF packed_secret_x(int i) noexcept { return GF(GF::max - i); }
+
+// Splits a secret into `n` shares using packed (ramp) secret sharing, so that
+// any `k` shares are enough to reconstruct the secret, whereas `k - ell` shares
+// reveal nothing about it.
+//
+// The secret is cut into `ell` blocks, padded with zeros, which are the values
+// of random polynomials of degree `k - 1` at the `x` values
+// `packed_secret_x(i)`. Each share is thus `ell` times smaller than the secret,
+// at the cost of a gap of `ell` between the number of shares revealing nothing
+// and the number of shares revealing everything.
+//
+// Returns the shares with the `x` values 1 to `n`.
+//
+// Precondition: 1 <= ell < k <= n <= GF::max - ell
+template <typename Random>
+std::vector<Share> split_packed(std::span<const GF> secret, int ell, int k,
+                                int n, Random&& random) {
+  if (ell < 1) throw std::runtime_error("Too few blocks");
+  if (k <= ell) throw std::runtime_error("Threshold must exceed block count");
+  if (n < k) throw std::runtime_error("Fewer shares than threshold");
+  if (n > GF::max - ell) throw std::runtime_error("Too many shares");
+
+  // Size of each block.
+  const std::size_t b = (secret.size() + ell - 1) / ell;
+
+  std::vector<Share> shares(n);
+  for (int i = 0; i < n; ++i) {
+    shares[i].x = GF(i + 1);
+    shares[i].ys.resize(b);
+  }
+
+  // The points at which the polynomials are known: the blocks of the secret,
+  // and then the `k - ell` random shares.
+  std::vector<GF> xs;
+  std::vector<std::span<const GF>> srcs;
+  std::vector<std::vector<GF>> padded;
+  padded.reserve(ell);
+  for (int i = 0; i < ell; ++i) {
+    const std::size_t pos = std::min(i * b, secret.size());
+    const std::size_t len = std::min(b, secret.size() - pos);
+    xs.push_back(packed_secret_x(i));
+    if (len == b) {
+      srcs.push_back(secret.subspan(pos, b));
+    } else {
+      // The last blocks are padded with zeros.
+      std::vector<GF>& block = padded.emplace_back(b);
+      std::copy_n(secret.begin() + pos, len, block.begin());
+      srcs.push_back(block);
+    }
+  }
+
+  for (int i = 0; i < k - ell; ++i) {
+    random(std::span(shares[i].ys));
+    xs.push_back(shares[i].x);
+    srcs.push_back(shares[i].ys);
+  }
+
+  const BarycentricWeights weights(xs);
+  std::vector<GF> cs(xs.size());
+  for (int i = k - ell; i < n; ++i) {
+    weights.coefficients(shares[i].x, cs);
+    dot(shares[i].ys, cs, srcs);
+  }
+
+  return shares;
+}
+
+// Reconstructs a secret of `size` values split by `split_packed` into `ell`
+// blocks with the threshold `k`, from at least `k` of its shares.
+//
+// Precondition: 1 <= ell < k <= shares.size()
+// Precondition: shares[i].x != shares[j].x for i != j
+// Precondition: shares[i].ys.size() == shares[j].ys.size() for i != j
+// Precondition: size <= ell * shares[i].ys.size()
+inline std::vector<GF> reconstruct_packed(std::span<const Share> shares,
+                                          int ell, int k, std::size_t size) {
+  if (ell < 1) throw std::runtime_error("Too few blocks");
+  if (k <= ell) throw std::runtime_error("Threshold must exceed block count");
+  if (shares.size() < std::size_t(k)) {
+    throw std::runtime_error("Too few shares");
+  }
+
+  const std::size_t b = shares.front().ys.size();
+  if (size > ell * b) {
+    throw std::runtime_error("Invalid packed secret size");
+  }
+
+  std::vector<GF> xs;
+  std::vector<std::span<const GF>> srcs;
+  for (const Share& s : shares) {
+    if (s.ys.size() != b) {
+      throw std::runtime_error(
+          "All the shares must have the same number of y values");
+    }
+
+    xs.push_back(s.x);
+    srcs.push_back(s.ys);
+  }
+
+  const BarycentricWeights weights(xs);
+  std::vector<GF> cs(xs.size());
+  std::vector<GF> secret(size);
+  std::vector<GF> last;
+  for (int i = 0; i < ell && i * b < size; ++i) {
+    weights.coefficients(packed_secret_x(i), cs);
+    const std::size_t len = std::min(b, size - i * b);
+    if (len == b) {
+      dot(std::span(secret).subspan(i * b, b), cs, srcs);
+    } else {
+      last.resize(b);
+      dot(last, cs, srcs);
+      std::copy_n(last.begin(), len, secret.begin() + i * b);
+    }
+  }
+
+  return secret;
+}
+
+// Batch of small items of the same size, such as keys or their shares, all
+// with the same `x` value. The items are stored transposed in a single plane:
+// the `y` value at position `j` of item `i` is stored at `ys[j * count + i]`.
+//
+// Since a batch is processed by the region operations as a single span, the
+// vectorization runs across the items, and the Lagrange coefficients are
+// computed once for the whole batch instead of once per item.
+struct ShareBatch {
+  GF x;
+
+  // Number of items.
+  std::size_t count = 0;
+
+  // Plane of `count * item_size()` values.
+  std::vector<GF> ys;
+
+  // Creates an empty batch.
+  ShareBatch() = default;
+
+  // Creates a batch of `count` items of `size` values, all zero.
+  ShareBatch(GF x, std::size_t count, std::size_t size)
+      : x(x), count(count), ys(count * size) {}
+
+  // Number of values of each item.
+  std::size_t item_size() const noexcept {
+    return count ? ys.size() / count : 0;
+  }
+
+  // Copies the values of the item `i` to `out`.
+  //
+  // Precondition: i < count
+  // Precondition: out.size() == item_size()
+  void get(std::size_t i, std::span<GF> out) const noexcept {
+    assert(i < count);
+    assert(out.size() == item_size());
+    for (std::size_t j = 0; j < out.size(); ++j) out[j] = ys[j * count + i];
+  }
+
+  // Gets the values of the item `i`.
+  //
+  // Precondition: i < count
+  std::vector<GF> get(std::size_t i) const {
+    std::vector<GF> out(item_size());
+    get(i, out);
+    return out;
+  }
+
+  // Sets the values of the item `i`.
+  //
+  // Precondition: i < count
+  // Precondition: in.size() == item_size()
+  void set(std::size_t i, std::span<const GF> in) noexcept {
+    assert(i < count);
+    assert(in.size() == item_size());
+    for (std::size_t j = 0; j < in.size(); ++j) ys[j * count + i] = in[j];
+  }
+
+  friend bool operator==(const ShareBatch& a, const ShareBatch& b) = default;
+};
+
+// Splits each item of a batch of secrets into `n` shares, like the `split`
+// function above, so that any `k` of them are enough to reconstruct the
+// secrets. Returns `n` batches of shares with the `x` values 1 to `n`, each
+// holding one share of every secret.
+//
+// Precondition: 2 <= k <= n <= GF::max
+template <typename Random>
+std::vector<ShareBatch> split_batch(const ShareBatch& secrets, int k, int n,
+                                    Random&& random) {
+  std::vector<Share> shares = split(secrets.ys, k, n, random);
+  std::vector<ShareBatch> r(n);
+  for (int i = 0; i < n; ++i) {
+    r[i].x = shares[i].x;
+    r[i].count = secrets.count;
+    r[i].ys = std::move(shares[i].ys);
+  }
+
+  return r;
+}
+
+// Interpolates the items of batches of shares at `dest_x`, like the
+// `interpolate` function above, but with a single computation of the Lagrange
+// coefficients and a single pass of the region operations for all the items.
+//
+// Precondition: shares.size() >= 2
+// Precondition: shares[i].x != shares[j].x for i != j
+// Precondition: shares[i].count == shares[j].count for i != j
+// Precondition: shares[i].ys.size() == shares[j].ys.size() for i != j
+inline ShareBatch interpolate_batch(std::span<const ShareBatch> shares,
+                                    GF dest_x) {
+  if (shares.size() < 2) {
+    throw std::runtime_error("Too few shares");
+  }
+
+  const ShareBatch& first = shares.front();
+  std::vector<GF> xs;
+  std::vector<std::span<const GF>> srcs;
+  xs.reserve(shares.size());
+  srcs.reserve(shares.size());
+
+  for (const ShareBatch& s : shares) {
+    if (s.count != first.count || s.ys.size() != first.ys.size()) {
+      throw std::runtime_error("All the share batches must have the same size");
+    }
+
+    xs.push_back(s.x);
+    srcs.push_back(s.ys);
+  }
+
+  ShareBatch r(dest_x, first.count, first.item_size());
+  dot(r.ys, lagrange_coefficients(xs, dest_x), srcs);
+  return r;
+}
+
+namespace gf256_internal {
+
+#if defined(__SSE2__)
+// Transposes the 16x16 matrix of bytes held in `v`, one row per register.
+//
+// Each round interleaves the rows `i` and `i + 8`, which rotates the 8 bits of
+// the position (row, column) of every byte by one. Four rounds swap the row and
+// column bits.
+inline void transpose16(__m128i (&v)[16]) noexcept {
+  for (int round = 0; round < 4; ++round) {
+    __m128i t[16];
+    for (int i = 0; i < 8; ++i) {
+      t[2 * i] = _mm_unpacklo_epi8(v[i], v[i + 8]);
+      t[2 * i + 1] = _mm_unpackhi_epi8(v[i], v[i + 8]);
+    }
+
+    std::copy_n(t, 16, v);
+  }
+}
+#endif
+
+// Computes out[j * n + i] = rows[i][j] for i in [0..n) and j in [0..m).
+inline void interleave(const GF::Bits* const* const rows, const std::size_t n,
+                       const std::size_t m, GF::Bits* const out) noexcept {
+  for (std::size_t b = 0; b < n; b += 16) {
+    const std::size_t h = std::min<std::size_t>(16, n - b);
+    std::size_t j = 0;
+
+#if defined(__SSE2__)
+    for (; j + 16 <= m; j += 16) {
+      __m128i v[16];
+      for (std::size_t i = 0; i < 16; ++i) {
+        v[i] = i < h ? _mm_loadu_si128(
+                           reinterpret_cast<const __m128i*>(rows[b + i] + j))
+                     : _mm_setzero_si128();
+      }
+
+      transpose16(v);
+      for (std::size_t c = 0; c < 16; ++c) {
+        GF::Bits* const d = out + (j + c) * n + b;
+        if (h == 16) {
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(d), v[c]);
+        } else {
+          alignas(16) GF::Bits tmp[16];
+          _mm_store_si128(reinterpret_cast<__m128i*>(tmp), v[c]);
+          std::copy_n(tmp, h, d);
+        }
+      }
+    }
+#endif
+
+    for (; j < m; ++j) {
+      for (std::size_t i = 0; i < h; ++i) out[j * n + b + i] = rows[b + i][j];
+    }
+  }
+}
+
+// Computes rows[i][j] = in[j * n + i] for i in [0..n) and j in [0..m).
+inline void deinterleave(const GF::Bits* const in, const std::size_t n,
+                         const std::size_t m,
+                         GF::Bits* const* const rows) noexcept {
+  for (std::size_t b = 0; b < n; b += 16) {
+    const std::size_t h = std::min<std::size_t>(16, n - b);
+    std::size_t j = 0;
+
+#if defined(__SSE2__)
+    for (; j + 16 <= m; j += 16) {
+      __m128i v[16];
+      for (std::size_t c = 0; c < 16; ++c) {
+        const GF::Bits* const s = in + (j + c) * n + b;
+        if (h == 16) {
+          v[c] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        } else {
+          alignas(16) GF::Bits tmp[16] = {};
+          std::copy_n(s, h, tmp);
+          v[c] = _mm_load_si128(reinterpret_cast<const __m128i*>(tmp));
+        }
+      }
+
+      transpose16(v);
+      for (std::size_t i = 0; i < h; ++i) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rows[b + i] + j), v[i]);
+      }
+    }
+#endif
+
+    for (; j < m; ++j) {
+      for (std::size_t i = 0; i < h; ++i) rows[b + i][j] = in[j * n + b + i];
+    }
+  }
+}
+
+}  // namespace gf256_internal
+
+// Converts `n` regions of `m` values to the interleaved layout, where the
+// values at the same position in all the regions are contiguous:
+// out[j * n + i] = rows[i][j] for i in [0..n) and j in [0..m).
+//
+// The conversion transposes blocks of 16x16 bytes in vector registers.
+//
+// Precondition: rows[i].size() == m for each i
+// Precondition: out.size() == n * m
+inline void interleave(std::span<const std::span<const GF>> rows,
+                       std::span<GF> out) {
+  using namespace gf256_internal;
+  const std::size_t n = rows.size();
+  const std::size_t m = n ? out.size() / n : 0;
+  assert(out.size() == n * m);
+  std::vector<const GF::Bits*> ptrs;
+  ptrs.reserve(n);
+  for (const std::span<const GF> row : rows) {
+    assert(row.size() == m);
+    ptrs.push_back(bits(row.data()));
+  }
+
+  interleave(ptrs.data(), n, m, bits(out.data()));
+}
+
+// Converts interleaved values back to `n` regions of `m` values:
+// rows[i][j] = in[j * n + i] for i in [0..n) and j in [0..m).
+//
+// Precondition: rows[i].size() == m for each i
+// Precondition: in.size() == n * m
+inline void deinterleave(std::span<const GF> in,
+                         std::span<const std::span<GF>> rows) {
+  using namespace gf256_internal;
+  const std::size_t n = rows.size();
+  const std::size_t m = n ? in.size() / n : 0;
+  assert(in.size() == n * m);
+  std::vector<GF::Bits*> ptrs;
+  ptrs.reserve(n);
+  for (const std::span<GF> row : rows) {
+    assert(row.size() == m);
+    ptrs.push_back(bits(row.data()));
+  }
+
+  deinterleave(bits(in.data()), n, m, ptrs.data());
+}
+
+// Shares of the same secret stored in the interleaved layout: the `y` value at
+// position `j` of the share `i` is stored at `ys[j * xs.size() + i]`, so that
+// all the values needed to reconstruct position `j` are contiguous.
+struct InterleavedShares {
+  // The `x` values of the shares.
+  std::vector<GF> xs;
+
+  // Plane of `xs.size() * size()` values.
+  std::vector<GF> ys;
+
+  // Creates an empty set of shares.
+  InterleavedShares() = default;
+
+  // Creates shares with the given `x` values and `size` values each, all zero.
+  InterleavedShares(std::vector<GF> xs, std::size_t size)
+      : xs(std::move(xs)), ys(this->xs.size() * size) {}
+
+  // Number of values of each share.
+  std::size_t size() const noexcept {
+    return xs.empty() ? 0 : ys.size() / xs.size();
+  }
+
+  // Values of all the shares at position `j`.
+  //
+  // Precondition: j < size()
+  std::span<const GF> column(std::size_t j) const noexcept {
+    assert(j < size());
+    return std::span(ys).subspan(j * xs.size(), xs.size());
+  }
+
+  friend bool operator==(const InterleavedShares& a,
+                         const InterleavedShares& b) = default;
+};
+
+// Converts shares to the interleaved layout.
+//
+// Precondition: shares[i].ys.size() == shares[j].ys.size() for i != j
+inline InterleavedShares interleave(std::span<const Share> shares) {
+  const std::size_t m = shares.empty() ? 0 : shares.front().ys.size();
+  std::vector<GF> xs;
+  std::vector<std::span<const GF>> rows;
+  xs.reserve(shares.size());
+  rows.reserve(shares.size());
+  for (const Share& s : shares) {
+    if (s.ys.size() != m) {
+      throw std::runtime_error(
+          "All the shares must have the same number of y values");
+    }
+
+    xs.push_back(s.x);
+    rows.push_back(s.ys);
+  }
+
+  InterleavedShares r(std::move(xs), m);
+  interleave(rows, r.ys);
+  return r;
+}
+
+// Converts shares from the interleaved layout.
+inline std::vector<Share> deinterleave(const InterleavedShares& shares) {
+  std::vector<Share> r(shares.xs.size());
+  std::vector<std::span<GF>> rows;
+  rows.reserve(r.size());
+  for (std::size_t i = 0; i < r.size(); ++i) {
+    r[i].x = shares.xs[i];
+    r[i].ys.resize(shares.size());
+    rows.push_back(r[i].ys);
+  }
+
+  deinterleave(shares.ys, rows);
+  return r;
+}
+
+// Interpolates shares stored in the interleaved layout at `dest_x`, like the
+// `interpolate` function above.
+//
+// The shares are transposed tile by tile into a small buffer that stays in the
+// cache, and each tile is reconstructed by the `dot` kernel.
+//
+// Precondition: shares.xs.size() >= 2
+// Precondition: shares.xs[i] != shares.xs[j] for i != j
+inline Share interpolate_interleaved(const InterleavedShares& shares,
+                                     GF dest_x) {
+  using namespace gf256_internal;
+  const std::size_t n = shares.xs.size();
+  if (n < 2) throw std::runtime_error("Too few shares");
+
+  const std::vector<GF> cs = lagrange_coefficients(shares.xs, dest_x);
+  const std::size_t m = shares.size();
+  const std::size_t w = std::min(tile_size, m);
+  std::vector<GF::Bits> buf(n * w);
+  std::vector<GF::Bits*> rows(n);
+  for (std::size_t i = 0; i < n; ++i) rows[i] = buf.data() + i * w;
+
+  Share r;
+  r.x = dest_x;
+  r.ys.resize(m);
+  for (std::size_t j = 0; j < m; j += w) {
+    const std::size_t len = std::min(w, m - j);
+    deinterleave(bits(shares.ys.data() + j * n), n, len, rows.data());
+    gf256_internal::dot(bits(r.ys.data() + j), len, cs.data(), rows.data(),
+                        n);
+  }
+
+  return r;
+}
+
+// Splits a secret into `n` shares with the `x` values 1 to `n`, like the
+// `split` function above, and returns them in the interleaved layout.
+//
+// The shares are computed tile by tile into a small buffer that stays in the
+// cache, and each tile is then interleaved into the result.
+//
+// Precondition: 2 <= k <= n <= GF::max
+template <typename Random>
+InterleavedShares split_interleaved(std::span<const GF> secret, int k, int n,
+                                    Random&& random) {
+  if (k < 2) throw std::runtime_error("Threshold must be at least 2");
+  if (n < k) throw std::runtime_error("Fewer shares than threshold");
+  if (n > GF::max) throw std::runtime_error("Too many shares");
+
+  std::vector<GF> xs(n);
+  for (int i = 0; i < n; ++i) xs[i] = GF(i + 1);
+
+  const SplitCoefficients cs(k, n);
+  const std::size_t m = secret.size();
+  const std::size_t w = std::min(gf256_internal::tile_size, m);
+  std::vector<GF> buf(n * w);
+  InterleavedShares r(std::move(xs), m);
+  std::vector<std::span<GF>> rows(n);
+  std::vector<std::span<const GF>> tile(n);
+  for (std::size_t j = 0; j < m; j += w) {
+    const std::size_t len = std::min(w, m - j);
+    for (int i = 0; i < n; ++i) {
+      rows[i] = std::span(buf).subspan(i * w, len);
+      tile[i] = rows[i];
+    }
+
+    split(secret.subspan(j, len), cs, rows, random);
+    interleave(tile, std::span(r.ys).subspan(j * n, len * n));
+  }
+
+  return r;
+}
+
+// Precomputed Lagrange coefficients for every set of `k` shares among the
+// shares with the `x` values 1 to `n`, and every `dest_x` that is either 0 or
+// the `x` value of a missing share.
+//
+// A set of shares is identified by a bitmask, where the bit `i - 1` is set if
+// the share with the `x` value `i` is present. The coefficients of the
+// C(n, k) sets are stored contiguously, in the colexicographic order of their
+// bitmasks, so that the coefficients of a set are found by computing its rank
+// instead of doing any field arithmetic.
+//
+// The space complexity is O(C(n, k) * (n - k + 1) * k).
+class CoefficientBank {
+ public:
+  // Precomputes the coefficients for all the sets of `k` shares among `n`.
+  //
+  // Precondition: 2 <= k <= n <= 64
+  CoefficientBank(int n, int k) : n_(n), k_(k) {
+    if (k < 2) throw std::runtime_error("Threshold must be at least 2");
+    if (n < k) throw std::runtime_error("Fewer shares than threshold");
+    if (n > 64) throw std::runtime_error("Too many shares");
+
+    for (int i = 0; i <= n; ++i) {
+      binomial_[i][0] = 1;
+      for (int j = 1; j <= i; ++j) {
+        binomial_[i][j] = binomial_[i - 1][j - 1] + binomial_[i - 1][j];
+      }
+    }
+
+    // Number of coefficient vectors per set.
+    const std::size_t dests = n - k + 1;
+    const std::uint64_t subsets = binomial_[n][k];
+    if (subsets > (std::size_t(1) << 28) / (dests * k)) {
+      throw std::runtime_error("Too many sets of shares");
+    }
+
+    coefficients_.resize(subsets * dests * k);
+
+    // Enumerate the bitmasks with `k` bits set in increasing order, which is
+    // their colexicographic order.
+    std::uint64_t subset = ~std::uint64_t(0) >> (64 - k);
+    std::vector<GF> xs;
+    for (std::uint64_t r = 0; r < subsets; ++r) {
+      assert(rank(subset) == r);
+
+      xs.clear();
+      for (int x = 1; x <= n; ++x) {
+        if (subset >> (x - 1) & 1) xs.push_back(GF(x));
+      }
+
+      GF* p = coefficients_.data() + r * dests * k;
+      for (int dest_x = 0; dest_x <= n; ++dest_x) {
+        if (dest_x > 0 && subset >> (dest_x - 1) & 1) continue;
+        const std::vector<GF> cs = lagrange_coefficients(xs, GF(dest_x));
+        p = std::copy(cs.begin(), cs.end(), p);
+      }
+
+      // Next bitmask with the same number of bits set.
+      const std::uint64_t c = subset & -subset;
+      const std::uint64_t t = subset + c;
+      subset = (((t ^ subset) >> 2) / c) | t;
+    }
+  }
+
+  int n() const noexcept { return n_; }
+  int k() const noexcept { return k_; }
+
+  // Gets the rank of the given set of shares, between 0 and C(n, k) - 1.
+  //
+  // Precondition: `subset` has `k` bits set, all below the bit `n`.
+  std::uint64_t rank(std::uint64_t subset) const noexcept {
+    std::uint64_t r = 0;
+    for (int i = 1; subset; ++i) {
+      const int c = std::countr_zero(subset);
+      r += binomial_[c][i];
+      subset &= subset - 1;
+    }
+
+    return r;
+  }
+
+  // Gets the Lagrange coefficients needed to interpolate the shares of the
+  // given set at `dest_x`. The coefficients are in increasing order of the `x`
+  // values of the shares.
+  //
+  // Throws: std::out_of_range if `subset` doesn't have exactly `k` bits set
+  //         among the `n` lowest bits, or if `dest_x` is neither 0 nor the `x`
+  //         value of a missing share.
+  std::span<const GF> coefficients(std::uint64_t subset, GF dest_x) const {
+    const std::uint64_t all = ~std::uint64_t(0) >> (64 - n_);
+    if (std::popcount(subset) != k_ || (subset & ~all) != 0) {
+      throw std::out_of_range("Invalid set of shares");
+    }
+
+    std::size_t dest = 0;
+    if (dest_x) {
+      const int x = dest_x.bits;
+      if (x > n_ || subset >> (x - 1) & 1) {
+        throw std::out_of_range("Invalid destination x value");
+      }
+
+      // Rank of `dest_x` among the missing shares, after 0.
+      const std::uint64_t below = (std::uint64_t(1) << (x - 1)) - 1;
+      dest = x - std::popcount(subset & below);
+    }
+
+    const std::size_t dests = n_ - k_ + 1;
+    return {coefficients_.data() + (rank(subset) * dests + dest) * k_,
+            std::size_t(k_)};
+  }
+
+  // Interpolates `k` shares with `x` values between 1 and `n` at `dest_x`,
+  // like the `interpolate` function, but without computing any coefficient.
+  //
+  // Throws: std::out_of_range if the `x` values are not distinct values
+  //         between 1 and `n`, or if `dest_x` is neither 0 nor the `x` value of
+  //         a missing share.
+  Share interpolate(std::span<const Share> shares, GF dest_x) const {
+    if (shares.size() != std::size_t(k_)) {
+      throw std::out_of_range("Invalid set of shares");
+    }
+
+    const std::size_t m = shares.front().ys.size();
+    std::uint64_t subset = 0;
+    for (const Share& s : shares) {
+      if (!s.x || s.x.bits > n_ || subset >> (s.x.bits - 1) & 1) {
+        throw std::out_of_range("Invalid set of shares");
+      }
+
+      if (s.ys.size() != m) {
+        throw std::runtime_error(
+            "All the shares must have the same number of y values");
+      }
+
+      subset |= std::uint64_t(1) << (s.x.bits - 1);
+    }
+
+    // Sort the shares by `x` value to match the order of the coefficients.
+    std::vector<std::span<const GF>> srcs(k_);
+    for (const Share& s : shares) {
+      const std::uint64_t below = (std::uint64_t(1) << (s.x.bits - 1)) - 1;
+      srcs[std::popcount(subset & below)] = s.ys;
+    }
+
+    Share r;
+    r.x = dest_x;
+    r.ys.resize(m);
+    dot(r.ys, coefficients(subset, dest_x), srcs);
+    return r;
+  }
+
+ private:
+  int n_;
+  int k_;
+
+  // Binomial coefficients C(i, j) for 0 <= j <= i <= 64. The other entries are
+  // zero.
+  std::array<std::array<std::uint64_t, 65>, 65> binomial_ = {};
+
+  std::vector<GF> coefficients_;
+};
+
+// Non-owning view of a share, whose `y` values are stored in external memory
+// such as a memory-mapped file or a network buffer.
+struct ShareView {
+  GF x;
+  std::span<const std::byte> ys;
+};
+
+// Interpolates polynomials like the `interpolate` function above, but reads the
+// `y` values directly from the memory referenced by the given share views, and
+// writes the `y` values of the resulting share directly to `out`. No copy of
+// the shares is made.
+//
+// Precondition: shares.size() >= 2
+// Precondition: shares[i].x != shares[j].x for i != j
+// Precondition: shares[i].ys.size() == out.size() for each i
+// Precondition: out does not overlap any shares[i].ys
+inline void interpolate(std::span<const ShareView> shares, GF dest_x,
+                        std::span<std::byte> out) {
+  if (shares.size() < 2) {
+    throw std::runtime_error("Too few shares");
+  }
+
+  // The kernel clears each tile of `out` before reading the shares.
+  const std::less<const std::byte*> less;
+  const auto overlaps = [&](std::span<const std::byte> ys) {
+    return !ys.empty() && !out.empty() &&
+           less(ys.data(), out.data() + out.size()) &&
+           less(out.data(), ys.data() + ys.size());
+  };
+
+  std::vector<GF> xs;
+  std::vector<const GF::Bits*> srcs;
+  xs.reserve(shares.size());
+  srcs.reserve(shares.size());
+
+  for (const ShareView& s : shares) {
+    if (s.ys.size() != out.size()) {
+      throw std::runtime_error(
+          "All the shares must have the same number of y values");
+    }
+
+    if (overlaps(s.ys)) {
+      throw std::runtime_error("The output must not overlap the shares");
+    }
+
+    xs.push_back(s.x);
+    srcs.push_back(gf256_internal::bits(s.ys.data()));
+  }
+
+  const std::vector<GF> cs = lagrange_coefficients(xs, dest_x);
+  gf256_internal::dot(gf256_internal::bits(out.data()), out.size(), cs.data(),
+                      srcs.data(), srcs.size());
+}
+
+// Source of the `y` values of a share, read on demand.
+//
+// This allows to reconstruct a range of values without loading whole shares
+// in memory. The values can come from files, memory mappings or any other
+// storage.
+struct ShareSource {
+  GF x;
+
+  // Reads the `y` values in the range [pos..pos + out.size()) into `out`.
+  std::function<void(std::size_t pos, std::span<GF> out)> read;
+};
+
+// Makes a source reading the `y` values of the given share, which must outlive
+// the source.
+inline ShareSource make_source(const Share& s) {
+  return {s.x, [&s](std::size_t pos, std::span<GF> out) {
+            if (pos > s.ys.size() || out.size() > s.ys.size() - pos) {
+              throw std::out_of_range("Range out of bounds of share");
+            }
+            std::copy_n(s.ys.begin() + pos, out.size(), out.begin());
+          }};
+}
+
+// Reconstructs arbitrary ranges of `y` values from share sources.
+//
+// Since the `y` value at position `j` of the interpolated share only depends on
+// the `y` values at position `j` of the source shares, reconstructing a range
+// only requires reading this range from each source. The Lagrange coefficients
+// are computed once at construction, so that the cost of each read is
+// proportional to the size of the range and not to the size of the shares.
+class RangeReconstructor {
+ public:
+  // Prepares the interpolation of the given `sources` at `dest_x`: validates
+  // the sources, computes their coefficients, and keeps the sources with a
+  // nonzero coefficient, which are the only ones read.
+  //
+  // Precondition: sources.size() >= 2
+  // Precondition: sources[i].x != sources[j].x for i != j
+  // Precondition: sources[i].read is not empty for each i
+  explicit RangeReconstructor(std::vector<ShareSource> sources,
+                              GF dest_x = GF(0))
+      : dest_x_(dest_x) {
+    std::vector<GF> xs;
+    xs.reserve(sources.size());
+    for (const ShareSource& s : sources) {
+      if (!s.read) throw std::runtime_error("Share source cannot be read");
+      xs.push_back(s.x);
+    }
+
+    // Also checks that there are enough sources with distinct x values.
+    const std::vector<GF> cs = lagrange_coefficients(xs, dest_x_);
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+      if (cs[i]) {
+        cs_.push_back(cs[i]);
+        sources_.push_back(std::move(sources[i]));
+      }
+    }
+  }
+
+  GF dest_x() const noexcept { return dest_x_; }
+
+  // Reconstructs the `y` values in the range [pos..pos + out.size()) into
+  // `out`. Sources with a zero coefficient are not read.
+  void read(std::size_t pos, std::span<GF> out) const {
+    // Maximum number of values read at once from each source.
+    constexpr std::size_t piece_size = 16 * gf256_internal::tile_size;
+
+    const std::size_t k = sources_.size();
+    std::vector<GF> buf(k * std::min(piece_size, out.size()));
+    std::vector<std::span<const GF>> srcs(k);
+
+    while (!out.empty()) {
+      const std::size_t len = std::min(piece_size, out.size());
+      for (std::size_t i = 0; i < k; ++i) {
+        const std::span<GF> b = std::span(buf).subspan(i * len, len);
+        sources_[i].read(pos, b);
+        srcs[i] = b;
+      }
+
+      dot(out.first(len), cs_, srcs);
+      out = out.subspan(len);
+      pos += len;
+    }
+  }
+
+  // Reconstructs the `length` `y` values starting at position `pos`.
+  std::vector<GF> read(std::size_t pos, std::size_t length) const {
+    std::vector<GF> ys(length);
+    read(pos, ys);
+    return ys;
+  }
+
+ private:
+  GF dest_x_;
+
+  // The sources with a nonzero coefficient, and their coefficients.
+  std::vector<ShareSource> sources_;
+  std::vector<GF> cs_;
+};
+
+// Reconstructs the `length` `y` values starting at position `offset` of the
+// share interpolated at `dest_x` from the given `sources`. Only this range is
+// read from each source.
+//
+// Use a RangeReconstructor to avoid recomputing the Lagrange coefficients when
+// reading several ranges from the same sources.
+//
+// Precondition: sources.size() >= 2
+// Precondition: sources[i].x != sources[j].x for i != j
+inline std::vector<GF> reconstruct_range(std::span<const ShareSource> sources,
+                                         std::size_t offset,
+                                         std::size_t length,
+                                         GF dest_x = GF(0)) {
+  return RangeReconstructor({sources.begin(), sources.end()}, dest_x)
+      .read(offset, length);
+}
+
+// Share interpolated lazily: each `y` value is computed when it is accessed,
+// by chunks of `chunk_size` values, and the last `cache_size` chunks used are
+// kept. Reading a header or a few records of a large share then only costs
+// the interpolation of the chunks containing them.
+//
+// The view references the given shares, which must outlive it, and computes
+// the Lagrange coefficients once at construction. It is a random access range
+// of `GF` values, which are returned by value.
+//
+// Since the cache is updated by the const accessors, a view must not be used
+// concurrently by several threads.
+class InterpolatedView {
+ public:
+  // Number of values computed at once.
+  static constexpr std::size_t chunk_size = gf256_internal::tile_size;
+
+  // Number of chunks kept in the cache.
+  static constexpr std::size_t cache_size = 4;
+
+  class Iterator;
+
+  // Prepares the interpolation of the given `shares` at `dest_x`.
+  //
+  // Precondition: shares.size() >= 2
+  // Precondition: shares[i].x != shares[j].x for i != j
+  // Precondition: shares[i].ys.size() == shares[j].ys.size() for i != j
+  explicit InterpolatedView(std::span<const Share> shares, GF dest_x = GF(0))
+      : dest_x_(dest_x) {
+    if (shares.size() < 2) {
+      throw std::runtime_error("Too few shares");
+    }
+
+    size_ = shares.front().ys.size();
+    std::vector<GF> xs;
+    xs.reserve(shares.size());
+    for (const Share& s : shares) {
+      if (s.ys.size() != size_) {
+        throw std::runtime_error(
+            "All the shares must have the same number of y values");
+      }
+
+      xs.push_back(s.x);
+      srcs_.push_back(gf256_internal::bits(s.ys.data()));
+    }
+
+    cs_ = lagrange_coefficients(xs, dest_x_);
+    ptrs_.resize(srcs_.size());
+  }
+
+  GF dest_x() const noexcept { return dest_x_; }
+
+  // Number of `y` values.
+  std::size_t size() const noexcept { return size_; }
+
+  // Number of chunks computed so far, including the ones computed again after
+  // being evicted from the cache.
+  std::size_t computed_chunks() const noexcept { return computed_chunks_; }
+
+  // Returns the `y` value at position `j`, computing its chunk if needed.
+  //
+  // Precondition: j < size()
+  GF operator[](std::size_t j) const {
+    assert(j < size_);
+    return chunk(j / chunk_size)[j % chunk_size];
+  }
+
+  Iterator begin() const noexcept;
+  Iterator end() const noexcept;
+
+ private:
+  struct Chunk {
+    // Index of the chunk, or `npos` if the entry is empty.
+    std::size_t index = npos;
+    std::uint64_t last_use = 0;
+    std::vector<GF> ys;
+  };
+
+  static constexpr std::size_t npos = -1;
+
+  // Returns the values of the chunk `index`, computed if not in the cache.
+  std::span<const GF> chunk(const std::size_t index) const {
+    ++clock_;
+    Chunk* victim = &cache_[0];
+    for (Chunk& c : cache_) {
+      if (c.index == index) {
+        c.last_use = clock_;
+        return c.ys;
+      }
+
+      if (c.last_use < victim->last_use) victim = &c;
+    }
+
+    const std::size_t pos = index * chunk_size;
+    const std::size_t len = std::min(chunk_size, size_ - pos);
+    for (std::size_t i = 0; i < srcs_.size(); ++i) ptrs_[i] = srcs_[i] + pos;
+
+    victim->index = index;
+    victim->last_use = clock_;
+    victim->ys.resize(len);
+    gf256_internal::dot(gf256_internal::bits(victim->ys.data()), len,
+                        cs_.data(), ptrs_.data(), ptrs_.size());
+    ++computed_chunks_;
+    return victim->ys;
+  }
+
+  GF dest_x_;
+  std::size_t size_ = 0;
+  std::vector<GF> cs_;
+
+  // Values of the shares.
+  std::vector<const GF::Bits*> srcs_;
+
+  // Values of the shares in the chunk being computed.
+  mutable std::vector<const GF::Bits*> ptrs_;
+
+  mutable std::array<Chunk, cache_size> cache_;
+  mutable std::uint64_t clock_ = 0;
+  mutable std::size_t computed_chunks_ = 0;
+};
+
+// Random access iterator over the values of an InterpolatedView.
+class InterpolatedView::Iterator {
+ public:
+  using iterator_concept = std::random_access_iterator_tag;
+  using iterator_category = std::input_iterator_tag;
+  using value_type = GF;
+  using difference_type = std::ptrdiff_t;
+
+  Iterator() noexcept = default;
+
+  Iterator(const InterpolatedView* view, std::size_t pos) noexcept
+      : view_(view), pos_(pos) {}
+
+  GF operator*() const { return (*view_)[pos_]; }
+  GF operator[](difference_type n) const { return (*view_)[pos_ + n]; }
+
+  Iterator& operator++() noexcept {
+    ++pos_;
+    return *this;
+  }
+
+  Iterator operator++(int) noexcept { return {view_, pos_++}; }
+
+  Iterator& operator--() noexcept {
+    --pos_;
+    return *this;
+  }
+
+  Iterator operator--(int) noexcept { return {view_, pos_--}; }
+
+  Iterator& operator+=(difference_type n) noexcept {
+    pos_ += n;
+    return *this;
+  }
+
+  Iterator& operator-=(difference_type n) noexcept {
+    pos_ -= n;
+    return *this;
+  }
+
+  friend Iterator operator+(Iterator it, difference_type n) noexcept {
+    return it += n;
+  }
+
+  friend Iterator operator+(difference_type n, Iterator it) noexcept {
+    return it += n;
+  }
+
+  friend Iterator operator-(Iterator it, difference_type n) noexcept {
+    return it -= n;
+  }
+
+  friend difference_type operator-(Iterator a, Iterator b) noexcept {
+    return difference_type(a.pos_) - difference_type(b.pos_);
+  }
+
+  friend bool operator==(Iterator a, Iterator b) noexcept {
+    return a.pos_ == b.pos_;
+  }
+
+  friend std::strong_ordering operator<=>(Iterator a, Iterator b) noexcept {
+    return a.pos_ <=> b.pos_;
+  }
+
+ private:
+  const InterpolatedView* view_ = nullptr;
+  std::size_t pos_ = 0;
+};
+
+inline InterpolatedView::Iterator InterpolatedView::begin() const noexcept {
+  return {this, 0};
+}
+
+inline InterpolatedView::Iterator InterpolatedView::end() const noexcept {
+  return {this, size_};
 }
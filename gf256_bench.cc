@@ -0,0 +1,358 @@
+// Benchmarks of the gf256 library.
+//
+// Usage: gf256-bench io [SIZE_MIB [DIR]]
+//        gf256-bench keys [COUNT]
+//        gf256-bench repair [SIZE_MIB]
+//        gf256-bench fetch [TRIALS]
+//        gf256-bench arena [COUNT]
+//
+// io: Splits a random file of SIZE_MIB MiB (default 256) stored in DIR
+// (default the current directory) into 5 shares with a threshold of 3, using
+// memory-mapped (buffered) I/O, direct I/O, and then a pipeline of threads.
+// Reports the throughput, the amount of page cache used by the input and share
+// files afterwards, and the utilization of each stage of the pipeline.
+//
+// keys: Reconstructs COUNT (default 1000000) random keys of 32 bytes from 3
+// shares, one key at a time and then as a single batch. Reports the number of
+// keys reconstructed per second.
+//
+// repair: Repairs a share of SIZE_MIB MiB (default 64) from 4 helper processes
+// over local sockets, with the helpers sending their shares to the repaired
+// node (star) or forwarding partial sums along a chain. Reports the repair
+// time, and the number of bytes sent on the busiest link and received by the
+// repaired node.
+//
+// fetch: Reconstructs a secret of 64 KiB from share servers on the loopback
+// interface TRIALS times (default 200), fetching either exactly 3 shares or
+// the first 3 of 5 shares. Each server usually answers after 1 ms, but 5% of
+// its answers take 20 ms. Reports the median and 99th percentile latencies.
+//
+// arena: Reconstructs COUNT (default 1000000) random keys of 32 bytes from 3
+// shares one at a time, with the default allocator and then with a monotonic
+// arena released after every 1000 keys. Reports the number of keys
+// reconstructed per second, and the number of heap allocations per key.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "gf256_fetch.h"
+#include "gf256_pipeline.h"
+#include "gf256_repair.h"
+
+// Number of heap allocations made by the whole program.
+std::atomic<std::size_t> heap_allocations = 0;
+
+// The replacements are not inlined, so that the compiler doesn't pair the
+// allocations of the standard library with malloc() and free().
+[[gnu::noinline]] void* operator new(std::size_t size) {
+  ++heap_allocations;
+  if (void* const p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+[[noreturn]] void usage() {
+  std::cerr << "Usage: gf256-bench io [SIZE_MIB [DIR]]\n"
+            << "       gf256-bench keys [COUNT]\n"
+            << "       gf256-bench repair [SIZE_MIB]\n"
+            << "       gf256-bench fetch [TRIALS]\n"
+            << "       gf256-bench arena [COUNT]" << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+// Number of bytes of the file at `path` currently in the page cache.
+std::size_t page_cache_footprint(const std::string& path) {
+  const File f(path, O_RDONLY);
+  const std::size_t size = f.size();
+  if (size == 0) return 0;
+
+  void* const p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, f.fd(), 0);
+  if (p == MAP_FAILED) throw_errno("Cannot map file");
+
+  static const std::size_t page_size = ::sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> pages((size + page_size - 1) / page_size);
+  const int r = ::mincore(p, size, pages.data());
+  ::munmap(p, size);
+  if (r < 0) throw_errno("Cannot get page cache residency");
+
+  std::size_t n = 0;
+  for (const unsigned char c : pages) n += c & 1;
+  return n * page_size;
+}
+
+// Writes the file at `path` back to the storage, and evicts it from the page
+// cache.
+void drop_from_page_cache(const std::string& path) {
+  const File f(path, O_RDONLY);
+  ::fdatasync(f.fd());
+  ::posix_fadvise(f.fd(), 0, 0, POSIX_FADV_DONTNEED);
+}
+
+void bench_io(std::size_t size_mib, const std::filesystem::path& dir) {
+  const std::string input = dir / "gf256-bench.in";
+  std::vector<std::string> outputs;
+  for (int i = 1; i <= 5; ++i) {
+    outputs.push_back(dir / ("gf256-bench.out." + std::to_string(i)));
+  }
+
+  {
+    const File f(input, O_WRONLY | O_CREAT | O_TRUNC);
+    std::vector<GF> buf(io_window_size);
+    for (std::size_t i = 0; i < size_mib; ++i) {
+      fill_random(buf);
+      f.write_at(std::as_bytes(std::span(buf)), i * buf.size());
+    }
+  }
+
+  const double mib = size_mib;
+  std::printf("%-8s %10s %10s %14s\n", "mode", "seconds", "MiB/s",
+              "cache (MiB)");
+
+  std::vector<StageStats> stats;
+  for (const char* const mode : {"buffered", "direct", "pipeline"}) {
+    drop_from_page_cache(input);
+
+    // Include the time needed to make the shares durable, since buffered
+    // writes are otherwise only written back later.
+    const auto start = std::chrono::steady_clock::now();
+    if (mode == std::string_view("pipeline")) {
+      stats = split_file_pipelined(input, 3, outputs);
+    } else {
+      split_file(input, 3, outputs,
+                 mode == std::string_view("direct") ? IoMode::direct
+                                                    : IoMode::mapped);
+    }
+    for (const std::string& path : outputs) {
+      ::fdatasync(File(path, O_RDONLY).fd());
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::size_t cached = page_cache_footprint(input);
+    for (const std::string& path : outputs) {
+      cached += page_cache_footprint(path);
+    }
+
+    std::printf("%-8s %10.3f %10.1f %14.1f\n", mode, elapsed.count(),
+                mib / elapsed.count(), cached / double(1 << 20));
+
+    for (const std::string& path : outputs) std::filesystem::remove(path);
+  }
+
+  std::printf("\n%-10s %12s\n", "stage", "utilization");
+  for (const StageStats& s : stats) {
+    std::printf("%-10s %11.1f%%\n", s.name.c_str(), 100 * s.utilization());
+  }
+
+  std::filesystem::remove(input);
+}
+
+void bench_keys(std::size_t count) {
+  constexpr std::size_t size = 32;
+  ShareBatch secrets(GF(0), count, size);
+  fill_random(secrets.ys);
+  std::vector<ShareBatch> shares = split_batch(secrets, 3, 3, fill_random);
+
+  std::vector<std::vector<Share>> keys(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    for (const ShareBatch& b : shares) keys[i].push_back({b.x, b.get(i)});
+  }
+
+  std::printf("%-8s %10s %14s\n", "mode", "seconds", "keys/s");
+  const auto report = [&](const char* mode, auto start) {
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::printf("%-8s %10.3f %14.0f\n", mode, elapsed.count(),
+                count / elapsed.count());
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::size_t errors = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    errors += interpolate(keys[i], GF(0)).ys != secrets.get(i);
+  }
+  report("single", start);
+
+  start = std::chrono::steady_clock::now();
+  errors += interpolate_batch(shares, GF(0)) != secrets;
+  report("batch", start);
+
+  if (errors) throw std::runtime_error("Wrong reconstruction");
+}
+
+void bench_repair(std::size_t size_mib) {
+  std::vector<GF> secret(size_mib << 20);
+  fill_random(secret);
+  const std::vector<Share> shares = split(secret, 4, 5, fill_random);
+  const std::span<const Share> helpers = std::span(shares).first(4);
+
+  std::printf("%-8s %10s %14s %14s\n", "mode", "seconds", "link (MiB)",
+              "received (MiB)");
+  std::vector<GF> out(secret.size());
+  for (const RepairMode mode : {RepairMode::star, RepairMode::chain}) {
+    const RepairStats stats = repair(helpers, shares[4].x, out, mode);
+    if (out != shares[4].ys) throw std::runtime_error("Wrong repair");
+
+    const std::size_t link =
+        *std::max_element(stats.link_bytes.begin(), stats.link_bytes.end());
+    std::printf("%-8s %10.3f %14.1f %14.1f\n",
+                mode == RepairMode::star ? "star" : "chain", stats.seconds,
+                link / double(1 << 20), stats.received_bytes / double(1 << 20));
+  }
+}
+
+void bench_fetch(int trials) {
+  std::vector<GF> secret(64 << 10);
+  fill_random(secret);
+  const std::vector<Share> shares = split(secret, 3, 5, fill_random);
+
+  std::mt19937 rng(std::random_device{}());
+  std::mutex mutex;
+  const auto delay = [&] {
+    const std::lock_guard lock(mutex);
+    return std::chrono::microseconds(
+        std::bernoulli_distribution(0.05)(rng) ? 20000 : 1000);
+  };
+
+  std::vector<std::unique_ptr<ShareServer>> servers;
+  std::vector<std::uint16_t> ports;
+  for (const Share& s : shares) {
+    servers.push_back(std::make_unique<ShareServer>(s, delay));
+    ports.push_back(servers.back()->port());
+  }
+
+  std::printf("%-8s %10s %10s\n", "mode", "p50 (ms)", "p99 (ms)");
+  for (const std::size_t n : {3, 5}) {
+    std::vector<double> latencies;
+    for (int i = 0; i < trials; ++i) {
+      FetchStats stats;
+      const Share r =
+          fetch_interpolate(std::span(ports).first(n), 3, GF(0), &stats);
+      if (r.ys != secret) throw std::runtime_error("Wrong reconstruction");
+      latencies.push_back(stats.seconds * 1000);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&](double q) {
+      return latencies[std::min<std::size_t>(latencies.size() - 1,
+                                             q * latencies.size())];
+    };
+    std::printf("%-8s %10.2f %10.2f\n", n == 3 ? "exact" : "hedged",
+                percentile(0.5), percentile(0.99));
+  }
+}
+
+void bench_arena(std::size_t count) {
+  constexpr std::size_t size = 32;
+  constexpr std::size_t keys_per_release = 1000;
+  ShareBatch secrets(GF(0), count, size);
+  fill_random(secrets.ys);
+  const std::vector<ShareBatch> shares =
+      split_batch(secrets, 3, 3, fill_random);
+
+  std::vector<std::vector<Share>> keys(count);
+  std::vector<std::vector<PmrShare>> pmr_keys(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    for (const ShareBatch& b : shares) {
+      const std::vector<GF> ys = b.get(i);
+      keys[i].push_back({b.x, ys});
+      pmr_keys[i].push_back({b.x, {ys.begin(), ys.end()}});
+    }
+  }
+
+  std::printf("%-8s %10s %14s %12s\n", "mode", "seconds", "keys/s",
+              "allocs/key");
+  std::size_t errors = 0;
+  const auto run = [&](const char* mode, auto f) {
+    const std::size_t allocations = heap_allocations;
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::printf("%-8s %10.3f %14.0f %12.2f\n", mode, elapsed.count(),
+                count / elapsed.count(),
+                double(heap_allocations - allocations) / count);
+  };
+
+  std::vector<GF> secret(size);
+  const auto check = [&](std::size_t i, std::span<const GF> ys) {
+    secrets.get(i, secret);
+    errors += !std::ranges::equal(ys, secret);
+  };
+
+  run("default", [&] {
+    for (std::size_t i = 0; i < count; ++i) {
+      check(i, interpolate(keys[i], GF(0)).ys);
+    }
+  });
+
+  std::vector<std::byte> buffer(std::size_t(1) << 20);
+  run("arena", [&] {
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+    for (std::size_t i = 0; i < count; ++i) {
+      if (i % keys_per_release == 0) arena.release();
+      check(i, interpolate(pmr_keys[i], GF(0), &arena).ys);
+    }
+  });
+
+  if (errors) throw std::runtime_error("Wrong reconstruction");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) usage();
+  const std::string what = argv[1];
+
+  try {
+    if (what == "io") {
+      if (argc > 4) usage();
+      const std::size_t size_mib = argc > 2 ? std::atoi(argv[2]) : 256;
+      const std::filesystem::path dir = argc > 3 ? argv[3] : ".";
+      bench_io(size_mib, dir);
+    } else if (what == "keys") {
+      if (argc > 3) usage();
+      bench_keys(argc > 2 ? std::atoi(argv[2]) : 1000000);
+    } else if (what == "repair") {
+      if (argc > 3) usage();
+      bench_repair(argc > 2 ? std::atoi(argv[2]) : 64);
+    } else if (what == "fetch") {
+      if (argc > 3) usage();
+      const int trials = argc > 2 ? std::atoi(argv[2]) : 200;
+      if (trials <= 0) usage();
+      bench_fetch(trials);
+    } else if (what == "arena") {
+      if (argc > 3) usage();
+      bench_arena(argc > 2 ? std::atoi(argv[2]) : 1000000);
+    } else {
+      usage();
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "gf256-bench: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "gf256_io.h"
+
+// Buffers of `y` values laid out for the region kernels.
+//
+// A GFBuffer is aligned on a cache line, and padded with zeros to a multiple of
+// the cache line size, so that the kernels can process whole vectors up to the
+// end of the padding without any scalar tail. Large buffers can be backed by
+// huge pages to limit the TLB misses when streaming through them.
+
+// Alignment of the values of a GFBuffer, and multiple to which their number is
+// padded. This is also the width of the largest vector registers.
+constexpr std::size_t gf_buffer_alignment = 64;
+
+// Size of the huge pages.
+constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+// Kind of pages backing a GFBuffer.
+enum class Pages {
+  // Regular pages allocated from the heap.
+  normal,
+
+  // Anonymous mapping that the kernel is advised to back with transparent huge
+  // pages (MADV_HUGEPAGE). The advice is ignored if they are disabled.
+  transparent_huge,
+
+  // Mapping of huge pages reserved by the administrator (MAP_HUGETLB).
+  huge,
+};
+
+// Zero-initialized array of `GF` values, with an aligned and padded storage.
+class GFBuffer {
+ public:
+  GFBuffer() noexcept = default;
+
+  // Allocates `size` values, all zero, backed by the given kind of `pages`. If
+  // no reserved huge pages are available, falls back to transparent huge pages.
+  //
+  // Throws: std::bad_alloc or std::system_error if the memory cannot be
+  // allocated.
+  explicit GFBuffer(std::size_t size, Pages pages = Pages::normal)
+      : size_(size) {
+    allocate(pages);
+  }
+
+  // Allocates a copy of `values`.
+  explicit GFBuffer(std::span<const GF> values, Pages pages = Pages::normal)
+      : GFBuffer(values.size(), pages) {
+    std::copy(values.begin(), values.end(), data_);
+  }
+
+  GFBuffer(const GFBuffer& other) : GFBuffer(other.span(), other.pages_) {}
+
+  GFBuffer(GFBuffer&& other) noexcept
+      : data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)),
+        padded_size_(std::exchange(other.padded_size_, 0)),
+        mapped_size_(std::exchange(other.mapped_size_, 0)),
+        pages_(std::exchange(other.pages_, Pages::normal)) {}
+
+  GFBuffer& operator=(GFBuffer other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(padded_size_, other.padded_size_);
+    std::swap(mapped_size_, other.mapped_size_);
+    std::swap(pages_, other.pages_);
+    return *this;
+  }
+
+  ~GFBuffer() {
+    if (!data_) return;
+    if (mapped_size_) {
+      ::munmap(data_, mapped_size_);
+    } else {
+      ::operator delete(data_, std::align_val_t(gf_buffer_alignment));
+    }
+  }
+
+  // Number of values.
+  std::size_t size() const noexcept { return size_; }
+
+  // Number of values including the padding, a multiple of
+  // `gf_buffer_alignment`.
+  std::size_t padded_size() const noexcept { return padded_size_; }
+
+  // Kind of pages actually backing the buffer.
+  Pages pages() const noexcept { return pages_; }
+
+  GF* data() noexcept { return data_; }
+  const GF* data() const noexcept { return data_; }
+
+  GF* begin() noexcept { return data_; }
+  GF* end() noexcept { return data_ + size_; }
+  const GF* begin() const noexcept { return data_; }
+  const GF* end() const noexcept { return data_ + size_; }
+
+  GF& operator[](std::size_t i) noexcept { return data_[i]; }
+  const GF& operator[](std::size_t i) const noexcept { return data_[i]; }
+
+  std::span<GF> span() noexcept { return {data_, size_}; }
+  std::span<const GF> span() const noexcept { return {data_, size_}; }
+
+  // Values including the padding. The padding must be left at zero by the
+  // callers, so that the kernels can process it like the other values.
+  std::span<GF> padded_span() noexcept { return {data_, padded_size_}; }
+  std::span<const GF> padded_span() const noexcept {
+    return {data_, padded_size_};
+  }
+
+  operator std::span<GF>() noexcept { return span(); }
+  operator std::span<const GF>() const noexcept { return span(); }
+
+  friend bool operator==(const GFBuffer& a, const GFBuffer& b) noexcept {
+    return std::ranges::equal(a.span(), b.span());
+  }
+
+ private:
+  void allocate(const Pages pages) {
+    padded_size_ = (size_ + gf_buffer_alignment - 1) / gf_buffer_alignment *
+                   gf_buffer_alignment;
+    pages_ = pages;
+    if (padded_size_ == 0) return;
+
+    if (pages == Pages::normal) {
+      data_ = static_cast<GF*>(::operator new(
+          padded_size_, std::align_val_t(gf_buffer_alignment)));
+      std::uninitialized_fill_n(data_, padded_size_, GF(0));
+      return;
+    }
+
+    // The mapped memory is zeroed by the kernel.
+    const std::size_t size = (padded_size_ + huge_page_size - 1) /
+                             huge_page_size * huge_page_size;
+    void* addr = MAP_FAILED;
+    if (pages == Pages::huge) {
+      addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+
+    if (addr == MAP_FAILED) {
+      addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (addr == MAP_FAILED) throw_errno("Cannot allocate memory");
+      ::madvise(addr, size, MADV_HUGEPAGE);
+      pages_ = Pages::transparent_huge;
+    }
+
+    data_ = static_cast<GF*>(addr);
+    mapped_size_ = size;
+  }
+
+  GF* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::size_t padded_size_ = 0;
+
+  // Size of the mapping, or 0 if the values are allocated from the heap.
+  std::size_t mapped_size_ = 0;
+
+  Pages pages_ = Pages::normal;
+};
+
+// Share whose `y` values are stored in a GFBuffer.
+struct AlignedShare {
+  GF x;
+  GFBuffer ys;
+
+  AlignedShare() = default;
+
+  AlignedShare(GF x, GFBuffer ys) : x(x), ys(std::move(ys)) {}
+
+  // Copies a share.
+  explicit AlignedShare(const Share& s, Pages pages = Pages::normal)
+      : x(s.x), ys(std::span<const GF>(s.ys), pages) {}
+
+  // Copies the share to a regular Share.
+  Share share() const { return {x, {ys.begin(), ys.end()}}; }
+
+  friend bool operator==(const AlignedShare& a,
+                         const AlignedShare& b) = default;
+};
+
+// Interpolates aligned shares at `dest_x`, like the `interpolate` function for
+// regular shares. The result is backed by the given kind of `pages`.
+//
+// The kernels run over the padded values: since the padding of all the shares
+// is zero, so is the padding of their linear combination.
+//
+// Precondition: shares.size() >= 2
+// Precondition: shares[i].x != shares[j].x for i != j
+// Precondition: shares[i].ys.size() == shares[j].ys.size() for i != j
+inline AlignedShare interpolate_aligned(std::span<const AlignedShare> shares,
+                                        GF dest_x,
+                                        Pages pages = Pages::normal) {
+  if (shares.size() < 2) {
+    throw std::runtime_error("Too few shares");
+  }
+
+  const std::size_t m = shares.front().ys.size();
+  std::vector<GF> xs;
+  std::vector<std::span<const GF>> srcs;
+  xs.reserve(shares.size());
+  srcs.reserve(shares.size());
+
+  for (const AlignedShare& s : shares) {
+    if (s.ys.size() != m) {
+      throw std::runtime_error(
+          "All the shares must have the same number of y values");
+    }
+
+    xs.push_back(s.x);
+    srcs.push_back(s.ys.padded_span());
+  }
+
+  AlignedShare r(dest_x, GFBuffer(m, pages));
+  dot(r.ys.padded_span(), lagrange_coefficients(xs, dest_x), srcs);
+  return r;
+}
@@ -0,0 +1,122 @@
+#include "gf256_buffer.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "gf256_test_util.h"
+
+namespace {
+
+bool is_aligned(const GF* const p) {
+  return reinterpret_cast<std::uintptr_t>(p) % gf_buffer_alignment == 0;
+}
+
+}  // namespace
+
+TEST(GF256Buffer, Layout) {
+  for (const Pages pages :
+       {Pages::normal, Pages::transparent_huge, Pages::huge}) {
+    for (const size_t m : {size_t(0), size_t(1), size_t(64), size_t(1000)}) {
+      GFBuffer buf(m, pages);
+      EXPECT_EQ(buf.size(), m);
+      EXPECT_EQ(buf.padded_size() % gf_buffer_alignment, 0);
+      EXPECT_GE(buf.padded_size(), m);
+      EXPECT_LT(buf.padded_size(), m + gf_buffer_alignment);
+      EXPECT_TRUE(m == 0 || is_aligned(buf.data()));
+      for (const GF y : buf.padded_span()) ASSERT_EQ(y, GF(0));
+
+      // Reserved huge pages are usually not available.
+      if (pages == Pages::normal || m == 0) {
+        EXPECT_EQ(buf.pages(), pages);
+      } else {
+        EXPECT_NE(buf.pages(), Pages::normal);
+      }
+
+      const std::span<GF> s = buf;
+      EXPECT_EQ(s.data(), buf.data());
+      EXPECT_EQ(s.size(), m);
+    }
+  }
+}
+
+TEST(GF256Buffer, CopyAndMove) {
+  std::vector<GF> values(300);
+  fill_pseudo_random(values);
+
+  GFBuffer a(values, Pages::transparent_huge);
+  EXPECT_TRUE(std::ranges::equal(a.span(), values));
+
+  GFBuffer b = a;
+  EXPECT_EQ(b, a);
+  EXPECT_NE(b.data(), a.data());
+  b[0] += GF(1);
+  EXPECT_NE(b, a);
+
+  const GF* const p = a.data();
+  GFBuffer c = std::move(a);
+  EXPECT_EQ(c.data(), p);
+  EXPECT_EQ(a.size(), 0);
+
+  b = c;
+  EXPECT_EQ(b, c);
+  b = GFBuffer();
+  EXPECT_EQ(b.size(), 0);
+}
+
+TEST(GF256Buffer, PartialPadding) {
+  // Sizes just below and above multiples of the alignment.
+  for (const size_t m : {size_t(1), size_t(63), size_t(65), size_t(127),
+                         size_t(129), size_t(4095)}) {
+    std::vector<GF> values(m);
+    fill_pseudo_random(values);
+
+    for (const Pages pages : {Pages::normal, Pages::transparent_huge}) {
+      const GFBuffer a(values, pages);
+      EXPECT_EQ(a.padded_size(),
+                (m / gf_buffer_alignment + 1) * gf_buffer_alignment);
+      EXPECT_TRUE(std::ranges::equal(a.span(), values));
+      for (const GF y : a.padded_span().subspan(m)) ASSERT_EQ(y, GF(0));
+
+      // Copies only compare and copy the values, and keep the padding zero.
+      const GFBuffer b = a;
+      EXPECT_EQ(b, a);
+      for (const GF y : b.padded_span().subspan(m)) ASSERT_EQ(y, GF(0));
+
+      // The kernels running over the padding leave it zero.
+      GFBuffer c = a;
+      add(c.padded_span(), b.padded_span());
+      for (const GF y : c.padded_span()) ASSERT_EQ(y, GF(0));
+      mul(c.padded_span(), GF(3), a.padded_span());
+      for (const GF y : c.padded_span().subspan(m)) ASSERT_EQ(y, GF(0));
+      EXPECT_EQ(c[m - 1], GF(3) * values[m - 1]);
+    }
+  }
+}
+
+TEST(GF256Buffer, Interpolate) {
+  for (const size_t m : {size_t(0), size_t(100), size_t(3) << 20}) {
+    std::vector<GF> secret(m);
+    fill_pseudo_random(secret);
+    const std::vector<Share> shares = split(secret, 3, 5, fill_pseudo_random);
+
+    const std::vector<AlignedShare> some = {
+        AlignedShare(shares[4]), AlignedShare(shares[0], Pages::huge),
+        AlignedShare(shares[2], Pages::transparent_huge)};
+    const AlignedShare r = interpolate_aligned(some, GF(0), Pages::huge);
+    EXPECT_TRUE(std::ranges::equal(r.ys.span(), secret));
+    for (const GF y : r.ys.padded_span().subspan(m)) ASSERT_EQ(y, GF(0));
+
+    EXPECT_EQ(interpolate_aligned(some, GF(2)).share(), shares[1]);
+  }
+
+  const std::vector<AlignedShare> bad = {
+      AlignedShare(Share{GF(1), std::vector<GF>(10)}),
+      AlignedShare(Share{GF(2), std::vector<GF>(11)})};
+  EXPECT_THROW(interpolate_aligned(bad, GF(0)), std::runtime_error);
+  EXPECT_THROW(interpolate_aligned(std::span(bad).first(1), GF(0)),
+               std::runtime_error);
+}
@@ -0,0 +1,30 @@
+// Reconstructs a file from share files produced by gf256-split.
+//
+// Usage: gf256-combine OUTPUT SHARE...
+//
+// At least THRESHOLD distinct share files must be given.
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gf256_io.h"
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    std::cerr << "Usage: gf256-combine OUTPUT SHARE..." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const std::string output = argv[1];
+  const std::vector<std::string> inputs(argv + 2, argv + argc);
+
+  try {
+    combine_files(inputs, output);
+  } catch (const std::exception& e) {
+    std::cerr << "gf256-combine: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
@@ -0,0 +1,473 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "gf256.h"
+
+// Statistics of a run of a WorkStealingExecutor.
+struct ExecutorStats {
+  // Duration of the run.
+  double wall_seconds = 0;
+
+  // Fraction of the run spent by each worker executing tasks.
+  std::vector<double> utilization;
+
+  // Number of tasks stolen by each worker from the other workers.
+  std::vector<std::size_t> steals;
+
+  // Total number of tasks executed.
+  std::size_t tasks = 0;
+
+  // Time between the start of the run and the completion of the jobs: median,
+  // 99th percentile and maximum.
+  double latency_p50 = 0;
+  double latency_p99 = 0;
+  double latency_max = 0;
+};
+
+// Executes batches of independent reconstruction and encoding jobs on a pool
+// of worker threads.
+//
+// Each job starts as a single task, which validates the job and then splits it
+// into chunk tasks of at most `chunk_size` positions. Each worker has its own
+// double-ended queue of tasks: it pushes and pops its tasks at the back, and
+// when it runs out of tasks, it steals from the front of the other workers'
+// queues. A few huge jobs are thus spread across all the workers instead of
+// keeping a single worker busy while the others are idle. A worker finding no
+// task spins for a short while, and then sleeps until tasks are pushed or the
+// run ends.
+//
+// The jobs only borrow their inputs and outputs, which must stay valid until
+// `run` returns.
+class WorkStealingExecutor {
+ public:
+  // Function filling a span with cryptographically secure random values. It is
+  // called concurrently by the worker threads.
+  using Random = std::function<void(std::span<GF>)>;
+
+  // Creates an executor with `workers` worker threads, splitting the jobs into
+  // chunks of `chunk_size` positions.
+  explicit WorkStealingExecutor(
+      std::size_t workers = std::max(1u, std::thread::hardware_concurrency()),
+      std::size_t chunk_size = 16 * gf256_internal::tile_size)
+      : queues_(workers), chunk_size_(chunk_size) {
+    if (workers == 0 || chunk_size == 0) {
+      throw std::runtime_error("Invalid executor parameters");
+    }
+  }
+
+  // Adds a job of `size` positions, calling `f(pos, len)` concurrently on
+  // chunks covering the positions 0 to `size`.
+  void add(std::size_t size,
+           std::function<void(std::size_t pos, std::size_t len)> f) {
+    Job& job = add_job();
+    jobs_to_start_.push_back(
+        [this, &job, size, f = std::move(f)](std::size_t w) {
+          spawn_chunks(w, job, size, f);
+        });
+  }
+
+  // Adds a job interpolating the given `shares` at `dest_x`, like the
+  // `interpolate` function, and writing the resulting `y` values to `out`.
+  //
+  // Precondition: shares.size() >= 2
+  // Precondition: shares[i].x != shares[j].x for i != j
+  // Precondition: shares[i].ys.size() == out.size() for each i
+  void add_interpolate(std::span<const Share> shares, GF dest_x,
+                       std::span<GF> out) {
+    Job& job = add_job();
+    jobs_to_start_.push_back([this, &job, shares, dest_x, out](std::size_t w) {
+      if (shares.size() < 2) throw std::runtime_error("Too few shares");
+
+      std::vector<GF> xs;
+      xs.reserve(shares.size());
+      for (const Share& s : shares) {
+        if (s.ys.size() != out.size()) {
+          throw std::runtime_error(
+              "All the shares must have the same number of y values");
+        }
+        xs.push_back(s.x);
+      }
+
+      auto cs = std::make_shared<const std::vector<GF>>(
+          lagrange_coefficients(xs, dest_x));
+      spawn_chunks(w, job, out.size(), [shares, out, cs](std::size_t pos,
+                                                         std::size_t len) {
+        std::vector<std::span<const GF>> srcs;
+        srcs.reserve(shares.size());
+        for (const Share& s : shares) {
+          srcs.push_back(std::span(s.ys).subspan(pos, len));
+        }
+        dot(out.subspan(pos, len), *cs, srcs);
+      });
+    });
+  }
+
+  // Adds a job splitting a `secret` into shares, like the `split` function.
+  //
+  // Precondition: 2 <= k <= shares.size() <= GF::max
+  // Precondition: shares[i].size() == secret.size() for each i
+  void add_split(std::span<const GF> secret, int k,
+                 std::span<const std::span<GF>> shares, Random random) {
+    Job& job = add_job();
+    jobs_to_start_.push_back(
+        [this, &job, secret, k, shares, random](std::size_t w) {
+          const int n = shares.size();
+          if (k < 2) throw std::runtime_error("Threshold must be at least 2");
+          if (n < k) throw std::runtime_error("Fewer shares than threshold");
+          if (n > GF::max) throw std::runtime_error("Too many shares");
+          for (const std::span<GF> s : shares) {
+            if (s.size() != secret.size()) {
+              throw std::runtime_error(
+                  "All the shares must have the same number of y values");
+            }
+          }
+
+          // Computed once for all the chunks.
+          auto cs = std::make_shared<const SplitCoefficients>(k, n);
+          spawn_chunks(w, job, secret.size(), [secret, cs, shares, random](
+                                                  std::size_t pos,
+                                                  std::size_t len) {
+            std::vector<std::span<GF>> ys;
+            ys.reserve(shares.size());
+            for (const std::span<GF> s : shares) {
+              ys.push_back(s.subspan(pos, len));
+            }
+            split(secret.subspan(pos, len), *cs, ys, random);
+          });
+        });
+  }
+
+  // Runs all the jobs added since the last run, and waits for their
+  // completion.
+  //
+  // Throws: the first exception thrown by a job, after stopping the workers.
+  ExecutorStats run() {
+    const std::size_t workers = queues_.size();
+    stop_ = false;
+    error_ = nullptr;
+    tasks_ = 0;
+    busy_.assign(workers, 0);
+    steals_.assign(workers, 0);
+
+    // Distribute the jobs across the workers in a round-robin fashion.
+    pending_ = jobs_to_start_.size();
+    for (std::size_t i = 0; i < jobs_to_start_.size(); ++i) {
+      queues_[i % workers].tasks.push_back(std::move(jobs_to_start_[i]));
+    }
+    jobs_to_start_.clear();
+
+    start_ = Clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t w = 1; w < workers; ++w) {
+      threads.emplace_back([this, w] { work(w); });
+    }
+    work(0);
+    for (std::thread& t : threads) t.join();
+    const double wall = seconds_since_start();
+
+    for (Queue& q : queues_) q.tasks.clear();
+    std::deque<Job> jobs = std::move(jobs_);
+    jobs_.clear();
+    if (error_) std::rethrow_exception(error_);
+
+    ExecutorStats stats;
+    stats.wall_seconds = wall;
+    stats.steals = steals_;
+    stats.tasks = tasks_;
+    for (const double busy : busy_) {
+      stats.utilization.push_back(wall > 0 ? busy / wall : 0);
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(jobs.size());
+    for (const Job& job : jobs) latencies.push_back(job.seconds);
+    std::sort(latencies.begin(), latencies.end());
+    if (!latencies.empty()) {
+      const auto percentile = [&](double q) {
+        return latencies[std::min<std::size_t>(latencies.size() - 1,
+                                               q * latencies.size())];
+      };
+      stats.latency_p50 = percentile(0.5);
+      stats.latency_p99 = percentile(0.99);
+      stats.latency_max = latencies.back();
+    }
+
+    return stats;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // Number of failed attempts to find a task before sleeping.
+  static constexpr int spin_count = 100;
+
+  // Task executed by the worker with the given index.
+  using Task = std::function<void(std::size_t w)>;
+
+  struct Job {
+    // Number of chunk tasks not completed yet.
+    std::atomic<std::size_t> remaining = 0;
+
+    // Time between the start of the run and the completion of the job.
+    double seconds = 0;
+  };
+
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  double seconds_since_start() const {
+    return std::chrono::duration<double>(Clock::now() - start_).count();
+  }
+
+  Job& add_job() { return jobs_.emplace_back(); }
+
+  // Splits the given job of `m` positions into chunks, and pushes the tasks
+  // calling `f(pos, len)` for each chunk to the queue of the worker `w`.
+  template <typename F>
+  void spawn_chunks(std::size_t w, Job& job, std::size_t m, F f) {
+    if (m == 0) {
+      job.seconds = seconds_since_start();
+      return;
+    }
+
+    const std::size_t n = (m + chunk_size_ - 1) / chunk_size_;
+    job.remaining = n;
+    pending_ += n;
+
+    const auto shared = std::make_shared<const F>(std::move(f));
+    {
+      Queue& q = queues_[w];
+      const std::lock_guard lock(q.mutex);
+      for (std::size_t pos = 0; pos < m; pos += chunk_size_) {
+        const std::size_t len = std::min(chunk_size_, m - pos);
+        q.tasks.push_back([this, &job, shared, pos, len](std::size_t) {
+          (*shared)(pos, len);
+          if (--job.remaining == 0) job.seconds = seconds_since_start();
+        });
+      }
+    }
+
+    signal();
+  }
+
+  // Pops a task from the back of the worker's own queue, or steals one from
+  // the front of another worker's queue.
+  std::optional<Task> next_task(std::size_t w) {
+    {
+      Queue& q = queues_[w];
+      const std::lock_guard lock(q.mutex);
+      if (!q.tasks.empty()) {
+        Task t = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return t;
+      }
+    }
+
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+      Queue& q = queues_[(w + i) % queues_.size()];
+      const std::lock_guard lock(q.mutex);
+      if (!q.tasks.empty()) {
+        Task t = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        ++steals_[w];
+        return t;
+      }
+    }
+
+    return std::nullopt;
+  }
+
+  // Wakes up the workers sleeping in `work`, after a push, the completion of
+  // the last task or a stop.
+  void signal() {
+    progress_.fetch_add(1);
+    if (sleepers_ > 0) progress_.notify_all();
+  }
+
+  void work(std::size_t w) {
+    for (int attempts = 0;; ++attempts) {
+      // Any change after this load makes the sleep below return at once.
+      const std::uint32_t seen = progress_;
+      if (pending_ == 0 || stop_) return;
+
+      std::optional<Task> t = next_task(w);
+      if (!t) {
+        if (attempts < spin_count) {
+          std::this_thread::yield();
+        } else {
+          ++sleepers_;
+          progress_.wait(seen);
+          --sleepers_;
+        }
+        continue;
+      }
+
+      attempts = 0;
+      const Clock::time_point start = Clock::now();
+      try {
+        (*t)(w);
+      } catch (...) {
+        const std::lock_guard lock(mutex_);
+        if (!error_) error_ = std::current_exception();
+        stop_ = true;
+        signal();
+      }
+      busy_[w] += std::chrono::duration<double>(Clock::now() - start).count();
+      ++tasks_;
+      if (--pending_ == 0) signal();
+    }
+  }
+
+  std::vector<Queue> queues_;
+  const std::size_t chunk_size_;
+
+  // Jobs added since the last run, with their initial tasks.
+  std::deque<Job> jobs_;
+  std::vector<Task> jobs_to_start_;
+
+  // Number of tasks queued or being executed.
+  std::atomic<std::size_t> pending_ = 0;
+
+  // Number of pushes, completions of the last task and stops so far, and
+  // number of workers sleeping until it changes.
+  std::atomic<std::uint32_t> progress_ = 0;
+  std::atomic<int> sleepers_ = 0;
+
+  // Statistics of the current run, indexed by worker.
+  std::vector<double> busy_;
+  std::vector<std::size_t> steals_;
+  std::atomic<std::size_t> tasks_ = 0;
+
+  Clock::time_point start_;
+  std::atomic<bool> stop_ = false;
+  std::mutex mutex_;
+  std::exception_ptr error_;
+};
+
+// Front end of a WorkStealingExecutor for large numbers of interpolation jobs
+// using only a few distinct combinations of `x` values.
+//
+// The jobs are grouped by set of `x` values and by `dest_x`. The Lagrange
+// coefficients are computed once per group, and indexed by `x` value, so that
+// each job only looks up the coefficients of its shares, whatever their order.
+class GroupedInterpolator {
+ public:
+  explicit GroupedInterpolator(WorkStealingExecutor& executor) noexcept
+      : executor_(executor) {}
+
+  // Adds a job interpolating the given `shares` at `dest_x`, like the
+  // `interpolate` function, and writing the resulting `y` values to `out`.
+  // The shares and `out` must stay valid until `run` returns.
+  //
+  // Precondition: shares.size() >= 2
+  // Precondition: shares[i].x != shares[j].x for i != j
+  // Precondition: shares[i].ys.size() == out.size() for each i
+  void add(std::span<const Share> shares, GF dest_x, std::span<GF> out) {
+    if (shares.size() < 2) throw std::runtime_error("Too few shares");
+
+    Key key;
+    key.dest_x = dest_x;
+    for (const Share& s : shares) {
+      if (s.ys.size() != out.size()) {
+        throw std::runtime_error(
+            "All the shares must have the same number of y values");
+      }
+
+      if (key.xs.test(s.x.bits)) {
+        throw std::runtime_error(
+            "All the shares must have distinct x values");
+      }
+
+      key.xs.set(s.x.bits);
+    }
+
+    groups_[key].push_back({shares, out});
+  }
+
+  // Computes the coefficients of each group, and runs all the jobs added since
+  // the last run on the executor.
+  //
+  // Throws: the first exception thrown by a job.
+  ExecutorStats run() {
+    group_count_ = groups_.size();
+    std::unordered_map<Key, std::vector<Job>, KeyHash> groups;
+    groups.swap(groups_);
+
+    for (const auto& [key, jobs] : groups) {
+      std::vector<GF> xs;
+      for (int x = 0; x <= GF::max; ++x) {
+        if (key.xs.test(x)) xs.push_back(GF(x));
+      }
+
+      std::array<GF, GF::max + 1> table = {};
+      const std::vector<GF> cs = lagrange_coefficients(xs, key.dest_x);
+      for (std::size_t i = 0; i < xs.size(); ++i) table[xs[i].bits] = cs[i];
+
+      for (const Job& job : jobs) {
+        std::vector<GF> job_cs;
+        job_cs.reserve(job.shares.size());
+        for (const Share& s : job.shares) job_cs.push_back(table[s.x.bits]);
+
+        executor_.add(job.out.size(), [shares = job.shares, out = job.out,
+                                       cs = std::move(job_cs)](
+                                          std::size_t pos, std::size_t len) {
+          std::vector<std::span<const GF>> srcs;
+          srcs.reserve(shares.size());
+          for (const Share& s : shares) {
+            srcs.push_back(std::span(s.ys).subspan(pos, len));
+          }
+          dot(out.subspan(pos, len), cs, srcs);
+        });
+      }
+    }
+
+    return executor_.run();
+  }
+
+  // Number of groups of jobs in the last run.
+  std::size_t group_count() const noexcept { return group_count_; }
+
+ private:
+  struct Key {
+    std::bitset<GF::max + 1> xs;
+    GF dest_x;
+
+    friend bool operator==(const Key& a, const Key& b) = default;
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key& k) const noexcept {
+      return std::hash<std::bitset<GF::max + 1>>()(k.xs) * 31 + k.dest_x.bits;
+    }
+  };
+
+  struct Job {
+    std::span<const Share> shares;
+    std::span<GF> out;
+  };
+
+  WorkStealingExecutor& executor_;
+  std::unordered_map<Key, std::vector<Job>, KeyHash> groups_;
+  std::size_t group_count_ = 0;
+};
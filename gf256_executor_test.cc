@@ -0,0 +1,143 @@
+#include "gf256_executor.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <ctime>
+#include <stdexcept>
+#include <vector>
+
+#include "gf256_test_util.h"
+
+TEST(GF256Executor, InterpolateAndSplit) {
+  WorkStealingExecutor executor(3, 1000);
+
+  // A few huge jobs among many small ones.
+  const std::vector<size_t> sizes = {0, 1, 100000, 7, 999, 1000, 1001, 250000};
+  std::vector<std::vector<GF>> secrets;
+  std::vector<std::vector<Share>> shares;
+  for (const size_t m : sizes) {
+    fill_pseudo_random(secrets.emplace_back(m));
+    shares.emplace_back(4);
+  }
+
+  std::vector<std::vector<std::span<GF>>> ys(sizes.size());
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    for (int j = 0; j < 4; ++j) {
+      shares[i][j].x = GF(j + 1);
+      shares[i][j].ys.resize(sizes[i]);
+      ys[i].push_back(shares[i][j].ys);
+    }
+    executor.add_split(secrets[i], 3, ys[i], fill_pseudo_random);
+  }
+
+  ExecutorStats stats = executor.run();
+  ASSERT_EQ(stats.utilization.size(), 3);
+  ASSERT_EQ(stats.steals.size(), 3);
+  EXPECT_GT(stats.tasks, sizes.size());
+  EXPECT_LE(stats.latency_p50, stats.latency_p99);
+  EXPECT_LE(stats.latency_p99, stats.latency_max);
+  EXPECT_LE(stats.latency_max, stats.wall_seconds);
+
+  // Any three shares reconstruct the secrets, and two reveal nothing.
+  std::vector<std::vector<GF>> outs;
+  for (const size_t m : sizes) outs.emplace_back(m);
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    const std::span<const Share> s = shares[i];
+    executor.add_interpolate(s.subspan(1), GF(0), outs[i]);
+  }
+
+  stats = executor.run();
+  for (size_t i = 0; i < sizes.size(); ++i) {
+    EXPECT_EQ(outs[i], secrets[i]);
+    EXPECT_EQ(interpolate(shares[i], GF(7)).ys,
+              interpolate(std::span(shares[i]).first(3), GF(7)).ys);
+  }
+
+  // Errors are reported after stopping the workers.
+  std::vector<GF> out(10);
+  executor.add_interpolate(shares[0], GF(0), out);
+  EXPECT_THROW(executor.run(), std::runtime_error);
+  executor.add_interpolate(std::span(shares[1]).first(1), GF(0), out);
+  EXPECT_THROW(executor.run(), std::runtime_error);
+
+  // The executor can be reused after an error.
+  executor.add_interpolate(shares[2], GF(0), outs[2]);
+  stats = executor.run();
+  EXPECT_EQ(outs[2], secrets[2]);
+  EXPECT_EQ(stats.tasks, 101);
+
+  EXPECT_THROW(WorkStealingExecutor(0), std::runtime_error);
+}
+
+TEST(GF256Executor, IdleWorkersSleep) {
+  // The workers without tasks wait for the single slow task without spinning.
+  WorkStealingExecutor executor(4);
+  executor.add(1, [](std::size_t, std::size_t) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  });
+
+  const std::clock_t cpu = std::clock();
+  const ExecutorStats stats = executor.run();
+  EXPECT_EQ(stats.tasks, 2);
+  EXPECT_LT(double(std::clock() - cpu) / CLOCKS_PER_SEC,
+            stats.wall_seconds / 2);
+}
+
+TEST(GF256Executor, GroupedInterpolator) {
+  WorkStealingExecutor executor(2, 64);
+  GroupedInterpolator interpolator(executor);
+
+  // Many jobs with shares of 5 polynomials, but only a few sets of x values.
+  std::vector<std::vector<Share>> shares;
+  for (int i = 0; i < 300; ++i) {
+    std::vector<GF> secret(i % 7 * 50);
+    fill_pseudo_random(secret);
+    shares.push_back(split(secret, 3, 5, fill_pseudo_random));
+  }
+
+  std::vector<std::vector<Share>> inputs;
+  std::vector<GF> dest_xs;
+  for (size_t i = 0; i < shares.size(); ++i) {
+    const std::vector<Share>& s = shares[i];
+    switch (i % 4) {
+      case 0:
+        inputs.push_back({s[0], s[1], s[2]});
+        break;
+      case 1:
+        inputs.push_back({s[2], s[0], s[1]});
+        break;
+      case 2:
+        inputs.push_back({s[4], s[3], s[1]});
+        break;
+      default:
+        inputs.push_back({s[0], s[3], s[4], s[1]});
+        break;
+    }
+    dest_xs.push_back(GF(i % 8 == 7 ? 9 : 0));
+  }
+
+  std::vector<std::vector<GF>> outs;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    outs.emplace_back(inputs[i][0].ys.size());
+    interpolator.add(inputs[i], dest_xs[i], outs[i]);
+  }
+
+  const ExecutorStats stats = interpolator.run();
+  EXPECT_EQ(interpolator.group_count(), 4);
+  EXPECT_GE(stats.tasks, inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    EXPECT_EQ(outs[i], interpolate(inputs[i], dest_xs[i]).ys);
+  }
+
+  // Invalid jobs are rejected when they are added.
+  std::vector<GF> out(shares[1][0].ys.size());
+  const std::vector<Share> dup = {shares[1][0], shares[1][0]};
+  EXPECT_THROW(interpolator.add(dup, GF(0), out), std::runtime_error);
+  EXPECT_THROW(interpolator.add(std::span(dup).first(1), GF(0), out),
+               std::runtime_error);
+  std::vector<GF> short_out(out.size() - 1);
+  EXPECT_THROW(interpolator.add(shares[1], GF(0), short_out),
+               std::runtime_error);
+}
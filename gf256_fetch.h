@@ -0,0 +1,341 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gf256_io.h"
+
+// Hedged reconstruction of shares fetched from share servers over TCP.
+//
+// A share server sends its share to each client connecting to it: a header of
+// 9 bytes holding the `x` value and the number `m` of `y` values in
+// little-endian order, and then the `m` values.
+//
+// The client connects to all the servers, and reconstructs each slice of the
+// result as soon as any `k` servers have sent it, so that a single slow server
+// doesn't delay the reconstruction. The connections to the remaining servers
+// are then closed.
+
+// Size of the header sent by a share server.
+constexpr std::size_t share_server_header_size = 9;
+
+// Number of `y` values reconstructed at once by `fetch_interpolate`.
+constexpr std::size_t fetch_slice_size = std::size_t(64) << 10;
+
+// Stand-in share server listening on the loopback interface, serving each
+// client from its own thread. The threads of the clients served are joined when
+// the next client connects.
+class ShareServer {
+ public:
+  // Function giving the time to wait before serving a client.
+  using Delay = std::function<std::chrono::microseconds()>;
+
+  // Starts serving `share` on an ephemeral port.
+  //
+  // Throws: std::system_error if the server socket cannot be created.
+  explicit ShareServer(Share share, Delay delay = {})
+      : share_(std::move(share)), delay_(std::move(delay)) {
+    listener_ = File(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (listener_.fd() < 0) throw_errno("Cannot create socket");
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (::bind(listener_.fd(), reinterpret_cast<sockaddr*>(&addr), len) < 0 ||
+        ::listen(listener_.fd(), SOMAXCONN) < 0 ||
+        ::getsockname(listener_.fd(), reinterpret_cast<sockaddr*>(&addr),
+                      &len) < 0) {
+      throw_errno("Cannot listen");
+    }
+
+    port_ = ntohs(addr.sin_port);
+    acceptor_ = std::thread([this] { accept_clients(); });
+  }
+
+  ShareServer(const ShareServer&) = delete;
+  ShareServer& operator=(const ShareServer&) = delete;
+
+  ~ShareServer() {
+    stop_ = true;
+    ::shutdown(listener_.fd(), SHUT_RDWR);
+    acceptor_.join();
+
+    const std::lock_guard lock(mutex_);
+    for (Client& c : clients_) c.thread.join();
+  }
+
+  // Port on which the server listens.
+  std::uint16_t port() const noexcept { return port_; }
+
+ private:
+  void accept_clients() {
+    while (!stop_) {
+      const int fd = ::accept4(listener_.fd(), nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd < 0) {
+        if (errno == EINTR || errno == ECONNABORTED) continue;
+        return;
+      }
+
+      const std::lock_guard lock(mutex_);
+      clients_.remove_if([](Client& c) {
+        if (!c.done) return false;
+        c.thread.join();
+        return true;
+      });
+
+      Client& c = clients_.emplace_back();
+      c.thread = std::thread([this, &done = c.done, client = File(fd)] {
+        serve(client);
+        done = true;
+      });
+    }
+  }
+
+  void serve(const File& client) const {
+    if (delay_) std::this_thread::sleep_for(delay_());
+
+    std::array<std::byte, share_server_header_size> header;
+    gf256_internal::store_le<std::uint8_t>(header.data(), share_.x.bits);
+    gf256_internal::store_le<std::uint64_t>(header.data() + 1,
+                                            share_.ys.size());
+    try {
+      gf256_internal::write_full(client.fd(), header);
+      gf256_internal::write_full(client.fd(),
+                                 std::as_bytes(std::span(share_.ys)));
+    } catch (const std::system_error&) {
+      // The client closed the connection.
+    }
+  }
+
+  // Thread serving a client.
+  struct Client {
+    std::thread thread;
+    std::atomic<bool> done = false;
+  };
+
+  const Share share_;
+  const Delay delay_;
+  File listener_;
+  std::uint16_t port_ = 0;
+  std::atomic<bool> stop_ = false;
+  std::thread acceptor_;
+  std::mutex mutex_;
+  std::list<Client> clients_;
+};
+
+// Measurements of a `fetch_interpolate` call.
+struct FetchStats {
+  // Time between the connection to the servers and the reconstruction of the
+  // last slice.
+  double seconds = 0;
+
+  // Number of bytes received from each server, including its header.
+  std::vector<std::size_t> received_bytes;
+};
+
+// Fetches the shares served on the loopback interface at the given `ports`,
+// and interpolates them at `dest_x` as soon as any `k` of them have arrived.
+// Passing exactly `k` ports fetches exactly `k` shares.
+//
+// The incoming data is multiplexed with epoll. Each slice of the result is
+// interpolated as soon as `k` servers have sent it, with the coefficients of
+// these `k` servers, and the connections are closed once the last slice is
+// done.
+//
+// Throws: std::runtime_error if fewer than `k` servers send a complete share.
+//
+// Precondition: 2 <= k <= ports.size() <= 64
+inline Share fetch_interpolate(std::span<const std::uint16_t> ports, int k,
+                               GF dest_x = GF(0), FetchStats* stats = nullptr) {
+  using namespace gf256_internal;
+  const std::size_t n = ports.size();
+  if (k < 2) throw std::runtime_error("Threshold must be at least 2");
+  if (n < std::size_t(k)) {
+    throw std::runtime_error("Fewer shares than threshold");
+  }
+  if (n > 64) throw std::runtime_error("Too many shares");
+
+  struct Peer {
+    File socket;
+    std::array<std::byte, share_server_header_size> header;
+    std::size_t received = 0;
+    GF x;
+    std::vector<GF> ys;
+    bool failed = false;
+
+    // Number of `y` values received.
+    std::size_t values() const noexcept {
+      return received < header.size() ? 0 : received - header.size();
+    }
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  const File epoll(::epoll_create1(EPOLL_CLOEXEC));
+  if (epoll.fd() < 0) throw_errno("Cannot create epoll instance");
+
+  std::vector<Peer> peers(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    Peer& p = peers[i];
+    p.socket =
+        File(::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+    if (p.socket.fd() < 0) throw_errno("Cannot create socket");
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(ports[i]);
+    if (::connect(p.socket.fd(), reinterpret_cast<sockaddr*>(&addr),
+                  sizeof(addr)) < 0 &&
+        errno != EINPROGRESS) {
+      p.failed = true;
+      continue;
+    }
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = i;
+    if (::epoll_ctl(epoll.fd(), EPOLL_CTL_ADD, p.socket.fd(), &ev) < 0) {
+      throw_errno("Cannot watch socket");
+    }
+  }
+
+  // Number of `y` values, known once a header has been received.
+  std::size_t m = 0;
+  bool known = false;
+
+  Share r;
+  r.x = dest_x;
+
+  // Number of values of the result already interpolated.
+  std::size_t done = 0;
+
+  // Lagrange coefficients of the sets of servers used so far.
+  std::map<std::uint64_t, std::vector<GF>> coefficients;
+
+  // Interpolates the slices that `k` servers have sent. Returns true once all
+  // the slices have been interpolated.
+  const auto advance = [&] {
+    std::vector<std::span<const GF>> srcs;
+    std::vector<GF> xs;
+    while (true) {
+      const std::size_t end = std::min(done + fetch_slice_size, m);
+      std::uint64_t set = 0;
+      srcs.clear();
+      xs.clear();
+      for (std::size_t i = 0; i < n && srcs.size() < std::size_t(k); ++i) {
+        const Peer& p = peers[i];
+        if (p.failed || p.values() < end || p.received < p.header.size()) {
+          continue;
+        }
+
+        set |= std::uint64_t(1) << i;
+        xs.push_back(p.x);
+        srcs.push_back(std::span(p.ys).subspan(done, end - done));
+      }
+
+      if (srcs.size() < std::size_t(k)) return false;
+      if (done == m) return true;
+
+      std::vector<GF>& cs = coefficients[set];
+      if (cs.empty()) cs = lagrange_coefficients(xs, dest_x);
+      dot(std::span(r.ys).subspan(done, end - done), cs, srcs);
+      done = end;
+    }
+  };
+
+  std::array<epoll_event, 64> events;
+  while (!known || !advance()) {
+    const std::size_t alive = std::count_if(
+        peers.begin(), peers.end(), [](const Peer& p) { return !p.failed; });
+    if (alive < std::size_t(k)) {
+      throw std::runtime_error("Too few shares available");
+    }
+
+    const int count =
+        ::epoll_wait(epoll.fd(), events.data(), events.size(), -1);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      throw_errno("Cannot wait for sockets");
+    }
+
+    for (int e = 0; e < count; ++e) {
+      Peer& p = peers[events[e].data.u64];
+      if (p.failed) continue;
+
+      // Read everything available: the header, and then the values.
+      while (true) {
+        std::span<std::byte> buf;
+        if (p.received < p.header.size()) {
+          buf = std::span(p.header).subspan(p.received);
+        } else {
+          buf = std::as_writable_bytes(std::span(p.ys)).subspan(p.values());
+          if (buf.empty()) {
+            // Complete share: stop watching the socket, which the server may
+            // close.
+            ::epoll_ctl(epoll.fd(), EPOLL_CTL_DEL, p.socket.fd(), nullptr);
+            p.socket = File();
+            break;
+          }
+        }
+
+        const ssize_t got = ::read(p.socket.fd(), buf.data(), buf.size());
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (got <= 0) {
+          p.failed = true;
+          ::epoll_ctl(epoll.fd(), EPOLL_CTL_DEL, p.socket.fd(), nullptr);
+          break;
+        }
+
+        p.received += got;
+        if (p.received != p.header.size()) continue;
+
+        // Complete header.
+        p.x = GF(load_le<std::uint8_t>(p.header.data()));
+        const std::size_t size = load_le<std::uint64_t>(p.header.data() + 1);
+        if (!known) {
+          m = size;
+          known = true;
+          r.ys.resize(m);
+        }
+
+        if (size != m) {
+          throw std::runtime_error(
+              "All the shares must have the same number of y values");
+        }
+
+        p.ys.resize(m);
+      }
+    }
+  }
+
+  if (stats) {
+    stats->seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    stats->received_bytes.clear();
+    for (const Peer& p : peers) stats->received_bytes.push_back(p.received);
+  }
+
+  return r;
+}
@@ -0,0 +1,161 @@
+#include "gf256_fetch.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "gf256_test_util.h"
+
+namespace {
+
+// Server sending only the first `limit` bytes of a share to its first client,
+// and then closing the connection.
+class TruncatingServer {
+ public:
+  TruncatingServer(const Share& share, std::size_t limit) {
+    listener_ = File(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (::bind(listener_.fd(), reinterpret_cast<sockaddr*>(&addr), len) < 0 ||
+        ::listen(listener_.fd(), 1) < 0 ||
+        ::getsockname(listener_.fd(), reinterpret_cast<sockaddr*>(&addr),
+                      &len) < 0) {
+      throw_errno("Cannot listen");
+    }
+    port_ = ntohs(addr.sin_port);
+
+    std::vector<std::byte> data(share_server_header_size);
+    gf256_internal::store_le<std::uint8_t>(data.data(), share.x.bits);
+    gf256_internal::store_le<std::uint64_t>(data.data() + 1, share.ys.size());
+    const std::span<const std::byte> ys = std::as_bytes(std::span(share.ys));
+    data.insert(data.end(), ys.begin(), ys.end());
+    data.resize(std::min(limit, data.size()));
+
+    thread_ = std::thread([this, data = std::move(data)] {
+      const File client(::accept4(listener_.fd(), nullptr, nullptr, 0));
+      try {
+        gf256_internal::write_full(client.fd(), data);
+      } catch (const std::system_error&) {
+        // The client closed the connection.
+      }
+    });
+  }
+
+  ~TruncatingServer() { thread_.join(); }
+
+  std::uint16_t port() const noexcept { return port_; }
+
+ private:
+  File listener_;
+  std::uint16_t port_ = 0;
+  std::thread thread_;
+};
+
+}  // namespace
+
+TEST(GF256Fetch, FetchInterpolate) {
+  using namespace std::chrono_literals;
+
+  for (const size_t m : {size_t(0), size_t(1000), 3 * fetch_slice_size + 5}) {
+    std::vector<GF> secret(m);
+    fill_pseudo_random(secret);
+    const std::vector<Share> shares = split(secret, 3, 5, fill_pseudo_random);
+
+    // The second server is very slow.
+    std::vector<std::unique_ptr<ShareServer>> servers;
+    std::vector<std::uint16_t> ports;
+    for (int i = 0; i < 5; ++i) {
+      ShareServer::Delay delay;
+      if (i == 1) delay = [] { return std::chrono::microseconds(500ms); };
+      servers.push_back(std::make_unique<ShareServer>(shares[i], delay));
+      ports.push_back(servers.back()->port());
+    }
+
+    // Any three servers are enough.
+    FetchStats stats;
+    const Share r = fetch_interpolate(ports, 3, GF(0), &stats);
+    EXPECT_EQ(r.x, GF(0));
+    EXPECT_EQ(r.ys, secret);
+    ASSERT_EQ(stats.received_bytes.size(), 5);
+    EXPECT_EQ(stats.received_bytes[1], 0);
+
+    const std::vector<std::uint16_t> fast = {ports[4], ports[0], ports[2]};
+    EXPECT_EQ(fetch_interpolate(fast, 3, GF(2)), shares[1]);
+  }
+
+  // Servers that cannot be reached.
+  std::vector<std::uint16_t> ports;
+  for (int i = 0; i < 3; ++i) {
+    ports.push_back(ShareServer(Share{GF(i + 1), {}}).port());
+  }
+  EXPECT_THROW(fetch_interpolate(ports, 2), std::runtime_error);
+  EXPECT_THROW(fetch_interpolate(std::span(ports).first(1), 2),
+               std::runtime_error);
+}
+
+TEST(GF256Fetch, WaitsWithoutSpinning) {
+  using namespace std::chrono_literals;
+
+  std::vector<GF> secret(1000);
+  fill_pseudo_random(secret);
+  const std::vector<Share> shares = split(secret, 3, 3, fill_pseudo_random);
+
+  // Two servers send their shares and close their connections long before the
+  // third one.
+  std::vector<std::unique_ptr<ShareServer>> servers;
+  std::vector<std::uint16_t> ports;
+  for (int i = 0; i < 3; ++i) {
+    ShareServer::Delay delay;
+    if (i == 2) delay = [] { return std::chrono::microseconds(200ms); };
+    servers.push_back(std::make_unique<ShareServer>(shares[i], delay));
+    ports.push_back(servers.back()->port());
+  }
+
+  const std::clock_t cpu = std::clock();
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(fetch_interpolate(ports, 3).ys, secret);
+
+  const std::chrono::duration<double> wall =
+      std::chrono::steady_clock::now() - start;
+  EXPECT_LT(double(std::clock() - cpu) / CLOCKS_PER_SEC, wall.count() / 2);
+
+  // A server serves many clients in turn.
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(fetch_interpolate(std::span(ports).first(2), 2, GF(1)),
+              shares[0]);
+  }
+}
+
+TEST(GF256Fetch, PeerClosesEarly) {
+  std::vector<GF> secret(3 * fetch_slice_size + 5);
+  fill_pseudo_random(secret);
+  const std::vector<Share> shares = split(secret, 2, 3, fill_pseudo_random);
+  const ShareServer good1(shares[1]);
+  const ShareServer good2(shares[2]);
+
+  // A server closing the connection in the middle of its header or of its
+  // values is left out, as long as `k` other servers send their shares.
+  for (const std::size_t limit :
+       {std::size_t(0), std::size_t(4), fetch_slice_size + 100}) {
+    const TruncatingServer bad(shares[0], limit);
+    const std::vector<std::uint16_t> ports = {bad.port(), good1.port(),
+                                              good2.port()};
+    FetchStats stats;
+    EXPECT_EQ(fetch_interpolate(ports, 2, GF(0), &stats).ys, secret);
+    EXPECT_LE(stats.received_bytes[0], limit);
+  }
+
+  // Otherwise, the reconstruction fails.
+  const TruncatingServer bad(shares[0], fetch_slice_size);
+  const std::vector<std::uint16_t> ports = {bad.port(), good1.port()};
+  EXPECT_THROW(fetch_interpolate(ports, 2), std::runtime_error);
+}
@@ -0,0 +1,804 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#include "gf256.h"
+
+// POSIX file helpers used to split and combine files of arbitrary size, and to
+// store shares in a binary share file format.
+//
+// The files are processed through memory-mapped windows of `io_window_size`
+// bytes, so that the resident memory stays bounded regardless of the size of
+// the files.
+
+// Number of bytes of each file mapped at once.
+constexpr std::size_t io_window_size = std::size_t(1) << 20;
+
+// Throws a std::system_error describing the current value of errno.
+[[noreturn]] inline void throw_errno(const std::string& what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Owned file descriptor.
+class File {
+ public:
+  File() noexcept = default;
+
+  explicit File(int fd) noexcept : fd_(fd) {}
+
+  // Opens the file at `path`.
+  // Throws: std::system_error if the file cannot be opened.
+  File(const std::string& path, int flags, mode_t mode = 0644)
+      : fd_(::open(path.c_str(), flags | O_CLOEXEC, mode)) {
+    if (fd_ < 0) throw_errno("Cannot open '" + path + "'");
+  }
+
+  File(File&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+
+  File& operator=(File&& other) noexcept {
+    std::swap(fd_, other.fd_);
+    return *this;
+  }
+
+  ~File() {
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  int fd() const noexcept { return fd_; }
+
+  // Gets the size of the file in bytes.
+  std::size_t size() const {
+    struct stat st;
+    if (::fstat(fd_, &st) < 0) throw_errno("Cannot stat file");
+    return st.st_size;
+  }
+
+  // Truncates or extends the file to `size` bytes.
+  void resize(std::size_t size) const {
+    if (::ftruncate(fd_, size) < 0) throw_errno("Cannot resize file");
+  }
+
+  // Reads up to `buf.size()` bytes at `offset`. Returns the number of bytes
+  // read, which is only less than `buf.size()` at the end of the file.
+  // Throws: std::system_error if the bytes cannot be read.
+  std::size_t read_some_at(std::span<std::byte> buf, std::size_t offset) const {
+    std::size_t total = 0;
+    while (total < buf.size()) {
+      const ssize_t n = ::pread(fd_, buf.data() + total, buf.size() - total,
+                                offset + total);
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) throw_errno("Cannot read file");
+      if (n == 0) break;
+      total += n;
+    }
+    return total;
+  }
+
+  // Reads exactly `buf.size()` bytes at `offset`.
+  // Throws: std::system_error if the bytes cannot be read.
+  void read_at(std::span<std::byte> buf, std::size_t offset) const {
+    if (read_some_at(buf, offset) != buf.size()) {
+      throw std::runtime_error("Unexpected end of file");
+    }
+  }
+
+  // Writes all the bytes of `buf` at `offset`.
+  // Throws: std::system_error if the bytes cannot be written.
+  void write_at(std::span<const std::byte> buf, std::size_t offset) const {
+    while (!buf.empty()) {
+      const ssize_t n = ::pwrite(fd_, buf.data(), buf.size(), offset);
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) throw_errno("Cannot write file");
+      buf = buf.subspan(n);
+      offset += n;
+    }
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+// Memory mapping of a range of bytes of a file. The range doesn't need to be
+// aligned on a page boundary.
+class MappedRegion {
+ public:
+  // Maps `size` bytes of `file` starting at `offset`. The mapping is shared,
+  // so that writes go directly to the page cache.
+  // Throws: std::system_error if the range cannot be mapped.
+  MappedRegion(const File& file, std::size_t offset, std::size_t size,
+               bool writable)
+      : size_(size) {
+    if (size == 0) return;
+
+    static const std::size_t page_size = ::sysconf(_SC_PAGESIZE);
+    const std::size_t skip = offset % page_size;
+    map_size_ = skip + size;
+
+    addr_ = ::mmap(nullptr, map_size_,
+                   writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                   file.fd(), offset - skip);
+    if (addr_ == MAP_FAILED) {
+      addr_ = nullptr;
+      throw_errno("Cannot map file");
+    }
+
+    // The region is only traversed once, from start to end.
+    ::madvise(addr_, map_size_, MADV_SEQUENTIAL);
+    data_ = reinterpret_cast<GF*>(static_cast<std::byte*>(addr_) + skip);
+  }
+
+  MappedRegion(MappedRegion&& other) noexcept
+      : addr_(std::exchange(other.addr_, nullptr)),
+        map_size_(std::exchange(other.map_size_, 0)),
+        data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+
+  MappedRegion& operator=(MappedRegion&& other) noexcept {
+    std::swap(addr_, other.addr_);
+    std::swap(map_size_, other.map_size_);
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+
+  ~MappedRegion() {
+    if (addr_) ::munmap(addr_, map_size_);
+  }
+
+  // Gets the mapped elements. They must not be modified if the region was not
+  // mapped as writable.
+  std::span<GF> span() const noexcept { return {data_, size_}; }
+
+ private:
+  void* addr_ = nullptr;
+  std::size_t map_size_ = 0;
+  GF* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+// Anonymous memory aligned on a page boundary, as needed by direct I/O.
+class PageBuffer {
+ public:
+  // Allocates `size` bytes of zeroed memory. If `shared` is true, the memory
+  // is shared with the child processes created by fork() afterwards.
+  //
+  // Throws: std::system_error if the memory cannot be allocated.
+  explicit PageBuffer(std::size_t size, bool shared = false) : size_(size) {
+    if (size == 0) return;
+    addr_ = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_ANONYMOUS, -1, 0);
+    if (addr_ == MAP_FAILED) {
+      addr_ = nullptr;
+      throw_errno("Cannot allocate memory");
+    }
+  }
+
+  PageBuffer(PageBuffer&& other) noexcept
+      : addr_(std::exchange(other.addr_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+
+  PageBuffer& operator=(PageBuffer&& other) noexcept {
+    std::swap(addr_, other.addr_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+
+  ~PageBuffer() {
+    if (addr_) ::munmap(addr_, size_);
+  }
+
+  std::span<GF> span() const noexcept {
+    return {static_cast<GF*>(addr_), size_};
+  }
+
+ private:
+  void* addr_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+// Fills `buf` with cryptographically secure random bytes from the kernel.
+// Throws: std::system_error if the random bytes cannot be obtained.
+inline void fill_random(std::span<GF> buf) {
+  while (!buf.empty()) {
+    const ssize_t n = ::getrandom(buf.data(), buf.size(), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) throw_errno("Cannot get random bytes");
+    buf = buf.subspan(n);
+  }
+}
+
+namespace gf256_internal {
+
+// Stores `v` in little-endian order at `p`.
+template <typename T>
+void store_le(std::byte* const p, T v) noexcept {
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    p[i] = std::byte(v & 0xFF);
+    v >>= 8;
+  }
+}
+
+// Loads a value stored in little-endian order at `p`.
+template <typename T>
+T load_le(const std::byte* const p) noexcept {
+  T v = 0;
+  for (std::size_t i = sizeof(T); i-- > 0;) {
+    v = (v << 8) | T(p[i]);
+  }
+  return v;
+}
+
+// Lookup table of the CRC32C (Castagnoli) checksum, in reflected form.
+constexpr std::array<std::uint32_t, 256> make_crc32c_table() noexcept {
+  std::array<std::uint32_t, 256> table = {};
+  for (std::uint32_t i = 0; i < 256; ++i) {
+    std::uint32_t c = i;
+    for (int j = 0; j < 8; ++j) c = (c >> 1) ^ (c & 1 ? 0x82F63B78 : 0);
+    table[i] = c;
+  }
+  return table;
+}
+
+inline constexpr std::array<std::uint32_t, 256> crc32c_table =
+    make_crc32c_table();
+
+// Reads exactly `buf.size()` bytes from the stream `fd`.
+inline void read_full(const int fd, std::span<std::byte> buf) {
+  while (!buf.empty()) {
+    const ssize_t n = ::read(fd, buf.data(), buf.size());
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw_errno("Cannot read from socket");
+    }
+
+    if (n == 0) throw std::runtime_error("Unexpected end of stream");
+    buf = buf.subspan(n);
+  }
+}
+
+// Writes all of `buf` to the socket `fd`.
+inline void write_full(const int fd, std::span<const std::byte> buf) {
+  while (!buf.empty()) {
+    const ssize_t n = ::send(fd, buf.data(), buf.size(), MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw_errno("Cannot write to socket");
+    }
+
+    buf = buf.subspan(n);
+  }
+}
+
+}  // namespace gf256_internal
+
+// Computes the CRC32C (Castagnoli) checksum of `data`. The checksum of
+// contiguous pieces can be computed by passing the checksum of the previous
+// pieces as `crc`.
+inline std::uint32_t crc32c(std::span<const std::byte> data,
+                            std::uint32_t crc = 0) noexcept {
+  crc = ~crc;
+  std::size_t i = 0;
+
+#if defined(__SSE4_2__) && defined(__x86_64__)
+  {
+    std::uint64_t c = crc;
+    for (; i + 8 <= data.size(); i += 8) {
+      std::uint64_t v;
+      std::memcpy(&v, data.data() + i, 8);
+      c = _mm_crc32_u64(c, v);
+    }
+    crc = std::uint32_t(c);
+  }
+#endif
+
+  for (; i < data.size(); ++i) {
+    crc = (crc >> 8) ^
+          gf256_internal::crc32c_table[(crc ^ std::uint32_t(data[i])) & 0xFF];
+  }
+
+  return ~crc;
+}
+
+// Size of the share file footer in bytes.
+constexpr std::size_t share_file_footer_size = 16;
+
+// Binary share file format.
+//
+// A share file starts with a header of `share_file_header_size` bytes. All the
+// integers are stored in little-endian order.
+//
+//   Offset  Size  Field
+//   0       8     Magic "GF256SHR"
+//   8       2     Format version (1)
+//   10      2     Reducing polynomial (0x11B for x^8 + x^4 + x^3 + x + 1)
+//   12      1     `x` value of the share
+//   13      1     Threshold (number of shares needed to reconstruct)
+//   14      2     Reserved (0)
+//   16      4     Chunk size in bytes
+//   20      4     Reserved (0)
+//   24      8     Number of `y` values
+//   32      8     Offset of the first `y` value in the file
+//   40      20    Reserved (0)
+//   60      4     CRC32C of the 60 previous bytes
+//
+// The `y` values follow, starting at the data offset. They are divided into
+// chunks of fixed size, except for the last chunk which can be shorter.
+//
+// A trailing index immediately follows the `y` values. It contains the CRC32C
+// of each chunk, as a 4-byte integer per chunk, followed by a footer:
+//
+//   Offset  Size  Field
+//   0       8     Number of chunks
+//   8       4     CRC32C of the index entries
+//   12      4     Magic "GFIX"
+//
+// Since the chunks have a fixed size, the position of any `y` value is known
+// from the header alone, and a range of `y` values can be read and verified
+// without reading the rest of the file.
+struct ShareFileHeader {
+  // The polynomial used by the GF class.
+  static constexpr std::uint16_t gf_polynomial = 0x11B;
+
+  GF x;
+  int threshold = 0;
+  std::uint16_t polynomial = gf_polynomial;
+  std::uint32_t chunk_size = 0;
+  std::uint64_t size = 0;
+  std::uint64_t data_offset = 0;
+
+  // Number of chunks containing the `y` values.
+  std::size_t chunk_count() const noexcept {
+    return (size + chunk_size - 1) / chunk_size;
+  }
+
+  // Offset of the trailing index in the file.
+  std::uint64_t index_offset() const noexcept { return data_offset + size; }
+
+  // Total size of the share file.
+  std::uint64_t file_size() const noexcept {
+    return index_offset() + 4 * chunk_count() + share_file_footer_size;
+  }
+
+  friend bool operator==(const ShareFileHeader&,
+                         const ShareFileHeader&) = default;
+};
+
+// Size of the share file header in bytes.
+constexpr std::size_t share_file_header_size = 64;
+
+// Default size of the share file chunks.
+constexpr std::size_t share_file_chunk_size = std::size_t(64) << 10;
+
+static_assert(io_window_size % share_file_chunk_size == 0);
+
+// Creates a share file and writes its header. The `y` values are then written
+// either through `file()` or through memory mappings, and the checksums of
+// their chunks must be computed by calling `add_checksums` before calling
+// `finish`.
+class ShareFileWriter {
+ public:
+  // Throws: std::system_error if the file cannot be created.
+  ShareFileWriter(const std::string& path, const ShareFileHeader& header)
+      : file_(path, O_RDWR | O_CREAT | O_TRUNC),
+        header_(header),
+        crcs_(header.chunk_count()) {
+    assert(header_.chunk_size > 0);
+    assert(header_.data_offset >= share_file_header_size);
+
+    std::byte b[share_file_header_size] = {};
+    std::memcpy(b, "GF256SHR", 8);
+    using gf256_internal::store_le;
+    store_le<std::uint16_t>(b + 8, 1);
+    store_le<std::uint16_t>(b + 10, header_.polynomial);
+    store_le<std::uint8_t>(b + 12, header_.x.bits);
+    store_le<std::uint8_t>(b + 13, header_.threshold);
+    store_le<std::uint32_t>(b + 16, header_.chunk_size);
+    store_le<std::uint64_t>(b + 24, header_.size);
+    store_le<std::uint64_t>(b + 32, header_.data_offset);
+    store_le<std::uint32_t>(b + 60, crc32c({b, 60}));
+
+    file_.write_at(b, 0);
+    file_.resize(header_.index_offset());
+  }
+
+  const File& file() const noexcept { return file_; }
+  const ShareFileHeader& header() const noexcept { return header_; }
+
+  // Computes the checksums of the chunks containing the `y` values `ys`
+  // written at position `pos`.
+  //
+  // Precondition: `pos` is a multiple of the chunk size
+  // Precondition: `ys` ends on a chunk boundary or at the end of the values
+  void add_checksums(std::span<const GF> ys, std::size_t pos) {
+    assert(pos % header_.chunk_size == 0);
+    assert(pos + ys.size() <= header_.size);
+    for (std::size_t i = 0; i < ys.size(); i += header_.chunk_size) {
+      const std::size_t len = std::min<std::size_t>(header_.chunk_size,
+                                                    ys.size() - i);
+      assert(len == header_.chunk_size || pos + i + len == header_.size);
+      crcs_[(pos + i) / header_.chunk_size] =
+          crc32c(std::as_bytes(ys.subspan(i, len)));
+    }
+  }
+
+  // Writes the trailing index and footer.
+  void finish() const {
+    std::vector<std::byte> b(4 * crcs_.size() + share_file_footer_size);
+    using gf256_internal::store_le;
+    for (std::size_t i = 0; i < crcs_.size(); ++i) {
+      store_le<std::uint32_t>(&b[4 * i], crcs_[i]);
+    }
+
+    std::byte* const footer = &b[4 * crcs_.size()];
+    store_le<std::uint64_t>(footer, crcs_.size());
+    store_le<std::uint32_t>(footer + 8, crc32c({b.data(), 4 * crcs_.size()}));
+    std::memcpy(footer + 12, "GFIX", 4);
+
+    file_.write_at(b, header_.index_offset());
+  }
+
+ private:
+  File file_;
+  ShareFileHeader header_;
+  std::vector<std::uint32_t> crcs_;
+};
+
+// Opens a share file, and checks its header and its index.
+class ShareFileReader {
+ public:
+  // Throws: std::system_error if the file cannot be opened.
+  // Throws: std::runtime_error if the file is not a valid share file.
+  explicit ShareFileReader(const std::string& path) : file_(path, O_RDONLY) {
+    const std::size_t file_size = file_.size();
+    if (file_size < share_file_header_size + share_file_footer_size) {
+      throw std::runtime_error("Truncated share file");
+    }
+
+    std::byte b[share_file_header_size];
+    file_.read_at(b, 0);
+    using gf256_internal::load_le;
+    if (std::memcmp(b, "GF256SHR", 8) != 0) {
+      throw std::runtime_error("Not a share file");
+    }
+
+    if (load_le<std::uint32_t>(b + 60) != crc32c({b, 60})) {
+      throw std::runtime_error("Corrupted share file header");
+    }
+
+    if (load_le<std::uint16_t>(b + 8) != 1) {
+      throw std::runtime_error("Unsupported share file version");
+    }
+
+    header_.polynomial = load_le<std::uint16_t>(b + 10);
+    header_.x = GF(load_le<std::uint8_t>(b + 12));
+    header_.threshold = load_le<std::uint8_t>(b + 13);
+    header_.chunk_size = load_le<std::uint32_t>(b + 16);
+    header_.size = load_le<std::uint64_t>(b + 24);
+    header_.data_offset = load_le<std::uint64_t>(b + 32);
+
+    if (header_.polynomial != ShareFileHeader::gf_polynomial) {
+      throw std::runtime_error("Unsupported reducing polynomial");
+    }
+
+    const std::size_t n = header_.chunk_size ? header_.chunk_count() : 0;
+    if (header_.chunk_size == 0 ||
+        header_.data_offset < share_file_header_size ||
+        header_.file_size() != file_size) {
+      throw std::runtime_error("Invalid share file layout");
+    }
+
+    std::vector<std::byte> index(4 * n + share_file_footer_size);
+    file_.read_at(index, header_.index_offset());
+    const std::byte* const footer = &index[4 * n];
+    if (std::memcmp(footer + 12, "GFIX", 4) != 0 ||
+        load_le<std::uint64_t>(footer) != n ||
+        load_le<std::uint32_t>(footer + 8) != crc32c({index.data(), 4 * n})) {
+      throw std::runtime_error("Corrupted share file index");
+    }
+
+    crcs_.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      crcs_[i] = load_le<std::uint32_t>(&index[4 * i]);
+    }
+  }
+
+  const File& file() const noexcept { return file_; }
+  const ShareFileHeader& header() const noexcept { return header_; }
+
+  // Checks the `y` values `ys` read at position `pos` against the checksums of
+  // their chunks.
+  //
+  // Precondition: `pos` is a multiple of the chunk size
+  // Precondition: `ys` ends on a chunk boundary or at the end of the values
+  // Throws: std::runtime_error if a checksum doesn't match.
+  void verify(std::span<const GF> ys, std::size_t pos) const {
+    assert(pos % header_.chunk_size == 0);
+    assert(pos + ys.size() <= header_.size);
+    for (std::size_t i = 0; i < ys.size(); i += header_.chunk_size) {
+      const std::size_t len = std::min<std::size_t>(header_.chunk_size,
+                                                    ys.size() - i);
+      if (crc32c(std::as_bytes(ys.subspan(i, len))) !=
+          crcs_[(pos + i) / header_.chunk_size]) {
+        throw std::runtime_error("Corrupted share file chunk");
+      }
+    }
+  }
+
+  // Reads the `y` values in the range [pos..pos + out.size()) into `out`. Only
+  // the chunks overlapping this range are read and verified.
+  //
+  // Throws: std::runtime_error if the range is out of bounds or if a checksum
+  // doesn't match.
+  void read(std::size_t pos, std::span<GF> out) const {
+    if (pos > header_.size || out.size() > header_.size - pos) {
+      throw std::out_of_range("Range out of bounds of share file");
+    }
+
+    const std::size_t chunk_size = header_.chunk_size;
+    std::vector<GF> chunk;
+    while (!out.empty()) {
+      const std::size_t start = pos - pos % chunk_size;
+      const std::size_t len =
+          std::min<std::size_t>(chunk_size, header_.size - start);
+      const std::size_t skip = pos - start;
+      const std::size_t n = std::min(len - skip, out.size());
+
+      // Read whole chunks directly into the destination.
+      const bool direct = skip == 0 && n == len;
+      if (!direct) chunk.resize(len);
+      const std::span<GF> buf = direct ? out.first(n) : std::span(chunk);
+
+      file_.read_at(std::as_writable_bytes(buf), header_.data_offset + start);
+      verify(buf, start);
+      if (!direct) std::copy_n(chunk.begin() + skip, n, out.begin());
+
+      out = out.subspan(n);
+      pos += n;
+    }
+  }
+
+ private:
+  File file_;
+  ShareFileHeader header_;
+  std::vector<std::uint32_t> crcs_;
+};
+
+// Makes a source reading the `y` values of the given share file, which must
+// outlive the source. The chunks read are verified.
+inline ShareSource make_source(const ShareFileReader& r) {
+  return {r.header().x,
+          [&r](std::size_t pos, std::span<GF> out) { r.read(pos, out); }};
+}
+
+// Writes `share` to a new share file at `path`.
+inline void write_share_file(const std::string& path, const Share& share,
+                             int threshold) {
+  ShareFileHeader h;
+  h.x = share.x;
+  h.threshold = threshold;
+  h.chunk_size = share_file_chunk_size;
+  h.size = share.ys.size();
+  h.data_offset = share_file_header_size;
+
+  ShareFileWriter w(path, h);
+  w.file().write_at(std::as_bytes(std::span(share.ys)), h.data_offset);
+  w.add_checksums(share.ys, 0);
+  w.finish();
+}
+
+// Reads the whole share file at `path`.
+inline Share read_share_file(const std::string& path) {
+  const ShareFileReader r(path);
+  Share s;
+  s.x = r.header().x;
+  s.ys.resize(r.header().size);
+  r.read(0, s.ys);
+  return s;
+}
+
+// Alignment of the offsets, sizes and buffers of direct I/O operations.
+constexpr std::size_t direct_io_alignment = 4096;
+
+static_assert(io_window_size % direct_io_alignment == 0);
+
+// How `split_file` accesses the files.
+enum class IoMode {
+  // Through memory mappings of the page cache.
+  mapped,
+
+  // With direct I/O (O_DIRECT) between page-aligned buffers and the storage,
+  // bypassing the page cache. This avoids evicting other useful data from the
+  // page cache when splitting very large files. The `y` values of the share
+  // files start at offset `direct_io_alignment`.
+  direct,
+};
+
+// Splits the secret contained in the file at `input` into `outputs.size()`
+// share files, so that any `k` of them are enough to reconstruct the secret.
+// The share written to `outputs[i]` has the `x` value `i + 1`.
+//
+// The secret is the value at x = 0 of random polynomials of degree `k - 1`.
+// The first `k - 1` shares are random, and the others are interpolated from
+// them and from the secret.
+//
+// Precondition: 2 <= k <= outputs.size() <= GF::max
+// Throws: std::system_error if `mode` is IoMode::direct and the file system
+// doesn't support direct I/O.
+inline void split_file(const std::string& input, int k,
+                       std::span<const std::string> outputs,
+                       IoMode mode = IoMode::mapped) {
+  const int n = outputs.size();
+
+  // Computed once for all the windows. Also checks the parameters.
+  const SplitCoefficients cs(k, n);
+
+  const bool direct = mode == IoMode::direct;
+  const File in(input, direct ? O_RDONLY | O_DIRECT : O_RDONLY);
+  const std::size_t m = in.size();
+
+  std::vector<ShareFileWriter> files;
+  files.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    ShareFileHeader h;
+    h.x = GF(i + 1);
+    h.threshold = k;
+    h.chunk_size = share_file_chunk_size;
+    h.size = m;
+    h.data_offset = direct ? direct_io_alignment : share_file_header_size;
+    files.emplace_back(outputs[i], h);
+  }
+
+  // Computes the shares of the window of the secret at position `pos`.
+  // `ys[0]` is the secret, and `ys[i]` is the share with the `x` value `i`.
+  const auto encode = [&](std::span<const std::span<GF>> ys, std::size_t pos) {
+    split(ys[0], cs, ys.subspan(1), fill_random);
+    for (int i = 0; i < n; ++i) files[i].add_checksums(ys[i + 1], pos);
+  };
+
+  if (!direct) {
+    for (std::size_t pos = 0; pos < m; pos += io_window_size) {
+      const std::size_t len = std::min(io_window_size, m - pos);
+
+      std::vector<MappedRegion> regions;
+      std::vector<std::span<GF>> ys;
+      regions.reserve(n + 1);
+      ys.push_back(regions.emplace_back(in, pos, len, false).span());
+      for (const ShareFileWriter& f : files) {
+        ys.push_back(
+            regions.emplace_back(f.file(), f.header().data_offset + pos, len,
+                                 true)
+                .span());
+      }
+
+      encode(ys, pos);
+    }
+  } else {
+    std::vector<File> outs;
+    outs.reserve(n);
+    for (const std::string& path : outputs) {
+      outs.emplace_back(path, O_WRONLY | O_DIRECT);
+    }
+
+    const PageBuffer buf((n + 1) * io_window_size);
+    for (std::size_t pos = 0; pos < m; pos += io_window_size) {
+      const std::size_t len = std::min(io_window_size, m - pos);
+
+      // Direct I/O operations must cover whole blocks. The last block of the
+      // values is padded with zeros, and truncated after writing.
+      const std::size_t padded = (len + direct_io_alignment - 1) /
+                                 direct_io_alignment * direct_io_alignment;
+
+      std::vector<std::span<GF>> ys;
+      for (int i = 0; i <= n; ++i) {
+        ys.push_back(buf.span().subspan(i * io_window_size, len));
+      }
+
+      const std::span<GF> secret = buf.span().first(padded);
+      if (in.read_some_at(std::as_writable_bytes(secret), pos) < len) {
+        throw std::runtime_error("Unexpected end of file");
+      }
+
+      encode(ys, pos);
+
+      for (int i = 0; i < n; ++i) {
+        const std::span<GF> y =
+            buf.span().subspan((i + 1) * io_window_size, padded);
+        std::fill(y.begin() + len, y.end(), GF(0));
+        outs[i].write_at(std::as_bytes(y), files[i].header().data_offset + pos);
+      }
+    }
+  }
+
+  for (const ShareFileWriter& f : files) {
+    f.finish();
+
+    // Remove the padding written by direct I/O.
+    if (direct) f.file().resize(f.header().file_size());
+  }
+}
+
+// Combines the share files at `inputs` to reconstruct the secret, and writes it
+// to the file at `output`. This interpolates the shares at x = 0.
+//
+// Precondition: inputs.size() >= threshold of the share files
+// Precondition: all the share files have distinct `x` values
+// Precondition: all the share files have the same number of `y` values
+inline void combine_files(std::span<const std::string> inputs,
+                          const std::string& output) {
+  if (inputs.empty()) throw std::runtime_error("Too few shares");
+
+  std::vector<ShareFileReader> files;
+  std::vector<GF> xs;
+  files.reserve(inputs.size());
+  for (const std::string& path : inputs) {
+    xs.push_back(files.emplace_back(path).header().x);
+  }
+
+  const ShareFileHeader& h = files.front().header();
+  if (int(inputs.size()) < std::max(h.threshold, 2)) {
+    throw std::runtime_error("Too few shares");
+  }
+
+  for (const ShareFileReader& f : files) {
+    if (f.header().size != h.size) {
+      throw std::runtime_error(
+          "All the shares must have the same number of y values");
+    }
+
+    if (f.header().threshold != h.threshold ||
+        f.header().chunk_size != h.chunk_size) {
+      throw std::runtime_error("Shares from different splits");
+    }
+  }
+
+  const std::vector<GF> cs = lagrange_coefficients(xs, GF(0));
+  const std::size_t m = h.size;
+  const File out(output, O_RDWR | O_CREAT | O_TRUNC);
+  out.resize(m);
+
+  // Read windows made of whole chunks, so that they can be verified.
+  const std::size_t window = std::max<std::size_t>(
+      io_window_size - io_window_size % h.chunk_size, h.chunk_size);
+
+  for (std::size_t pos = 0; pos < m; pos += window) {
+    const std::size_t len = std::min(window, m - pos);
+
+    std::vector<MappedRegion> regions;
+    std::vector<std::span<const GF>> srcs;
+    regions.reserve(files.size());
+    for (const ShareFileReader& f : files) {
+      const std::span<const GF> ys =
+          regions
+              .emplace_back(f.file(), f.header().data_offset + pos, len, false)
+              .span();
+      f.verify(ys, pos);
+      srcs.push_back(ys);
+    }
+
+    const MappedRegion dest(out, pos, len, true);
+    dot(dest.span(), cs, srcs);
+  }
+}
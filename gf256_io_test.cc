@@ -0,0 +1,215 @@
+#include "gf256_io.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "gf256_test_util.h"
+
+namespace {
+
+// Temporary directory deleted at the end of the test.
+class TempDir {
+ public:
+  TempDir() {
+    std::string tmpl =
+        (std::filesystem::temp_directory_path() / "gf256_test.XXXXXX");
+    if (!::mkdtemp(tmpl.data())) throw_errno("Cannot create temp dir");
+    path_ = tmpl;
+  }
+
+  ~TempDir() { std::filesystem::remove_all(path_); }
+
+  std::string operator/(const std::string& name) const {
+    return path_ / name;
+  }
+
+ private:
+  std::filesystem::path path_;
+};
+
+void write_file(const std::string& path, std::span<const GF> data) {
+  const File f(path, O_WRONLY | O_CREAT | O_TRUNC);
+  f.write_at(std::as_bytes(data), 0);
+}
+
+std::vector<GF> read_file(const std::string& path) {
+  const File f(path, O_RDONLY);
+  std::vector<GF> data(f.size());
+  f.read_at(std::as_writable_bytes(std::span(data)), 0);
+  return data;
+}
+
+}  // namespace
+
+TEST(GF256IO, SplitCombineFile) {
+  const TempDir dir;
+
+  // Use a size that is not a multiple of the window size.
+  for (const size_t m : {size_t(0), size_t(1000), 2 * io_window_size + 123}) {
+    const std::vector<GF> secret = random_bytes(m);
+    write_file(dir / "secret", secret);
+
+    const std::vector<std::string> shares = {dir / "s1", dir / "s2",
+                                             dir / "s3", dir / "s4",
+                                             dir / "s5"};
+    split_file(dir / "secret", 3, shares);
+
+    for (int i = 0; i < 5; ++i) {
+      const ShareFileReader reader(shares[i]);
+      const ShareFileHeader& h = reader.header();
+      EXPECT_EQ(h.x, GF(i + 1));
+      EXPECT_EQ(h.threshold, 3);
+      EXPECT_EQ(h.size, m);
+      EXPECT_EQ(h.data_offset, share_file_header_size);
+    }
+
+    // Any three shares reconstruct the secret.
+    const std::vector<std::string> in1 = {shares[4], shares[0], shares[2]};
+    combine_files(in1, dir / "out1");
+    EXPECT_EQ(read_file(dir / "out1"), secret);
+
+    const std::vector<std::string> in2 = {shares[1], shares[3], shares[4]};
+    combine_files(in2, dir / "out2");
+    EXPECT_EQ(read_file(dir / "out2"), secret);
+
+    // Two shares are not enough.
+    const std::vector<std::string> in3 = {shares[1], shares[3]};
+    EXPECT_THROW(combine_files(in3, dir / "out3"), std::runtime_error);
+  }
+
+  EXPECT_THROW(split_file(dir / "secret", 1, std::vector<std::string>(3)),
+               std::runtime_error);
+  EXPECT_THROW(split_file(dir / "missing", 2, {}), std::runtime_error);
+  EXPECT_THROW(combine_files({}, dir / "out"), std::runtime_error);
+}
+
+TEST(GF256IO, SplitFileDirect) {
+  const TempDir dir;
+
+  // Use sizes that are not multiples of the direct I/O alignment.
+  for (const size_t m : {size_t(0), size_t(1000), io_window_size + 4097}) {
+    const std::vector<GF> secret = random_bytes(m);
+    write_file(dir / "secret", secret);
+
+    const std::vector<std::string> shares = {dir / "s1", dir / "s2",
+                                             dir / "s3", dir / "s4"};
+    try {
+      split_file(dir / "secret", 2, shares, IoMode::direct);
+    } catch (const std::system_error& e) {
+      if (e.code() == std::errc::invalid_argument) {
+        GTEST_SKIP() << "Direct I/O is not supported";
+      }
+      throw;
+    }
+
+    for (const std::string& s : shares) {
+      const ShareFileReader reader(s);
+      const ShareFileHeader& h = reader.header();
+      EXPECT_EQ(h.size, m);
+      EXPECT_EQ(h.data_offset, direct_io_alignment);
+    }
+
+    const std::vector<std::string> in = {shares[3], shares[1]};
+    combine_files(in, dir / "out");
+    EXPECT_EQ(read_file(dir / "out"), secret);
+  }
+}
+
+TEST(GF256IO, Crc32c) {
+  EXPECT_EQ(crc32c({}), 0);
+
+  const std::string s = "123456789";
+  const std::span<const std::byte> b = std::as_bytes(std::span(s));
+  EXPECT_EQ(crc32c(b), 0xE3069283);
+
+  // Checksums can be computed piecewise.
+  EXPECT_EQ(crc32c(b.subspan(4), crc32c(b.first(4))), 0xE3069283);
+}
+
+TEST(GF256IO, ShareFile) {
+  const TempDir dir;
+  const std::string path = dir / "share";
+
+  // Use a size that is not a multiple of the chunk size.
+  const Share share = {GF(7), random_bytes(3 * share_file_chunk_size + 10)};
+  write_share_file(path, share, 4);
+
+  const ShareFileReader r(path);
+  EXPECT_EQ(r.header().x, GF(7));
+  EXPECT_EQ(r.header().threshold, 4);
+  EXPECT_EQ(r.header().polynomial, 0x11B);
+  EXPECT_EQ(r.header().size, share.ys.size());
+  EXPECT_EQ(r.header().chunk_count(), 4);
+  EXPECT_EQ(read_share_file(path), share);
+
+  // Read ranges overlapping chunk boundaries.
+  for (const size_t pos : {size_t(0), size_t(5), share_file_chunk_size - 3,
+                           3 * share_file_chunk_size}) {
+    for (const size_t len : {size_t(0), size_t(3), size_t(10),
+                             share_file_chunk_size + 7}) {
+      if (pos + len > share.ys.size()) continue;
+      std::vector<GF> ys(len);
+      r.read(pos, ys);
+      EXPECT_TRUE(std::equal(ys.begin(), ys.end(), share.ys.begin() + pos));
+    }
+  }
+
+  std::vector<GF> ys(2);
+  EXPECT_THROW(r.read(share.ys.size() - 1, ys), std::out_of_range);
+
+  // Corrupt a byte of the second chunk.
+  {
+    const File f(path, O_RDWR);
+    const std::byte b{0xFF};
+    f.write_at({&b, 1}, r.header().data_offset + share_file_chunk_size + 1);
+  }
+
+  // Only the ranges touching the corrupted chunk fail to read.
+  const ShareFileReader corrupted(path);
+  corrupted.read(0, std::span(ys).first(1));
+  corrupted.read(2 * share_file_chunk_size, ys);
+  EXPECT_THROW(corrupted.read(share_file_chunk_size + 5, ys),
+               std::runtime_error);
+
+  // Corrupt the header.
+  {
+    const File f(path, O_RDWR);
+    const std::byte b{8};
+    f.write_at({&b, 1}, 12);
+  }
+
+  EXPECT_THROW(ShareFileReader{path}, std::runtime_error);
+
+  // Not a share file.
+  write_file(dir / "other", random_bytes(100));
+  EXPECT_THROW(ShareFileReader(dir / "other"), std::runtime_error);
+}
+
+TEST(GF256IO, ReconstructRangeFromFiles) {
+  const TempDir dir;
+
+  const std::vector<GF> secret = random_bytes(5 * share_file_chunk_size + 17);
+  write_file(dir / "secret", secret);
+
+  const std::vector<std::string> shares = {dir / "s1", dir / "s2",
+                                           dir / "s3", dir / "s4"};
+  split_file(dir / "secret", 2, shares);
+
+  const ShareFileReader r2(shares[1]);
+  const ShareFileReader r3(shares[3]);
+  const RangeReconstructor r({make_source(r2), make_source(r3)});
+
+  for (const size_t pos : {size_t(0), 2 * share_file_chunk_size - 100,
+                           secret.size() - 4096}) {
+    EXPECT_TRUE(std::ranges::equal(r.read(pos, 4096),
+                                   std::span(secret).subspan(pos, 4096)));
+  }
+
+  EXPECT_THROW(r.read(secret.size() - 1, 2), std::out_of_range);
+}
@@ -0,0 +1,438 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gf256_io.h"
+
+// Bounded lock-free queue with a single producer thread and a single consumer
+// thread.
+template <typename T>
+class SpscQueue {
+ public:
+  // Creates a queue holding at least `capacity` items.
+  explicit SpscQueue(std::size_t capacity) {
+    std::size_t n = 1;
+    while (n < capacity) n *= 2;
+    items_.resize(n);
+    mask_ = n - 1;
+  }
+
+  // Pushes an item. Returns false if the queue is full. Must only be called by
+  // the producer thread.
+  bool try_push(T item) {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_) return false;
+    }
+
+    items_[tail & mask_] = std::move(item);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Pops an item. Returns nothing if the queue is empty. Must only be called by
+  // the consumer thread.
+  std::optional<T> try_pop() {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) return std::nullopt;
+    }
+
+    std::optional<T> item = std::move(items_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return item;
+  }
+
+ private:
+  std::vector<T> items_;
+  std::size_t mask_ = 0;
+
+  // Position of the next item to pop, and the producer's copy of it.
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::size_t cached_head_ = 0;
+
+  // Position of the next item to push, and the consumer's copy of it.
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  alignas(64) std::size_t cached_tail_ = 0;
+};
+
+// Buffer traveling through the stages of a Pipeline.
+struct PipelineBuffer {
+  // Sequence number of the buffer, assigned by the reader stage.
+  std::size_t index = 0;
+
+  // Memory of the buffer, aligned on a page boundary.
+  std::span<GF> data;
+
+  // Number of meaningful bytes in `data`, set by the reader stage.
+  std::size_t size = 0;
+};
+
+// Time spent by a pipeline stage doing useful work.
+struct StageStats {
+  std::string name;
+
+  // Time spent in the stage's function.
+  double busy_seconds = 0;
+
+  // Lifetime of the stage's thread.
+  double wall_seconds = 0;
+
+  // Fraction of time spent doing useful work rather than waiting for the
+  // other stages.
+  double utilization() const noexcept {
+    return wall_seconds > 0 ? busy_seconds / wall_seconds : 0;
+  }
+};
+
+// Pipeline of threads reading, processing and writing buffers.
+//
+// A reader thread fills the buffers, which are processed by worker threads,
+// and then consumed in order by a writer thread. The stages exchange buffers
+// through lock-free single-producer single-consumer queues: the reader hands
+// the buffers to the workers in a round-robin fashion, and the writer takes
+// them back from the workers in the same order. The writer returns the
+// buffers to the reader through a free list, so that no memory is allocated
+// in the steady state.
+//
+// A stage waiting for a queue first spins for a short while, and then sleeps
+// until another stage pushes or pops a buffer, so that an idle pipeline doesn't
+// keep the cores busy.
+//
+// The utilization of each stage shows whether the I/O stages or the workers
+// are the bottleneck.
+class Pipeline {
+ public:
+  // Fills the given buffer. Returns false if there is nothing more to read.
+  using Reader = std::function<bool(PipelineBuffer&)>;
+
+  // Processes the given buffer. Called concurrently by the worker threads.
+  using Worker = std::function<void(PipelineBuffer&)>;
+
+  // Consumes the given buffer. Called in the order of the buffer indices.
+  using Writer = std::function<void(PipelineBuffer&)>;
+
+  // Creates a pipeline with `workers` worker threads and `buffer_count`
+  // buffers of `buffer_size` bytes.
+  Pipeline(std::size_t buffer_size, std::size_t buffer_count,
+           std::size_t workers)
+      : stride_(page_align(buffer_size)),
+        memory_(buffer_count * stride_),
+        buffers_(buffer_count),
+        free_(buffer_count) {
+    if (buffer_count == 0 || workers == 0) {
+      throw std::runtime_error("Invalid pipeline parameters");
+    }
+
+    for (std::size_t i = 0; i < workers; ++i) {
+      to_workers_.emplace_back(
+          std::make_unique<SpscQueue<std::size_t>>(buffer_count + 1));
+      from_workers_.emplace_back(
+          std::make_unique<SpscQueue<std::size_t>>(buffer_count + 1));
+    }
+
+    for (std::size_t i = 0; i < buffer_count; ++i) {
+      buffers_[i].data = memory_.span().subspan(i * stride_, buffer_size);
+    }
+  }
+
+  // Runs the pipeline until `read` returns false and all the buffers have been
+  // written.
+  //
+  // Throws: the first exception thrown by a stage, after stopping all of them.
+  void run(const Reader& read, const Worker& work, const Writer& write) {
+    // Discard the end markers and the buffers left over by the previous run.
+    stop_ = false;
+    error_ = nullptr;
+    clear(free_);
+    for (const std::unique_ptr<Queue>& q : to_workers_) clear(*q);
+    for (const std::unique_ptr<Queue>& q : from_workers_) clear(*q);
+    for (std::size_t i = 0; i < buffers_.size(); ++i) free_.try_push(i);
+
+    const std::size_t workers = to_workers_.size();
+    stats_.assign(workers + 2, {});
+    stats_.front().name = "reader";
+    stats_.back().name = "writer";
+    for (std::size_t i = 0; i < workers; ++i) {
+      stats_[i + 1].name = "worker " + std::to_string(i);
+    }
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&] { stage(stats_.front(), [&] { reader(read); }); });
+    for (std::size_t i = 0; i < workers; ++i) {
+      threads.emplace_back(
+          [&, i] { stage(stats_[i + 1], [&] { worker(i, work); }); });
+    }
+    stage(stats_.back(), [&] { writer(write); });
+
+    for (std::thread& t : threads) t.join();
+    if (error_) std::rethrow_exception(error_);
+  }
+
+  // Gets the statistics of the reader, workers and writer of the last run.
+  const std::vector<StageStats>& stats() const noexcept { return stats_; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  using Queue = SpscQueue<std::size_t>;
+
+  // Rounds `size` up to a multiple of the page size, so that every buffer
+  // starts on a page boundary, as O_DIRECT requires.
+  static std::size_t page_align(std::size_t size) {
+    static const std::size_t page_size = ::sysconf(_SC_PAGESIZE);
+    return (size + page_size - 1) / page_size * page_size;
+  }
+
+  // Index sent through the queues to indicate the end of the buffers.
+  static constexpr std::size_t end = std::numeric_limits<std::size_t>::max();
+
+  // Number of failed attempts to push or pop before sleeping.
+  static constexpr int spin_count = 100;
+
+  // Runs the function `f` of a stage, measuring its lifetime and catching its
+  // exceptions.
+  template <typename F>
+  void stage(StageStats& stats, F f) {
+    const Clock::time_point start = Clock::now();
+    try {
+      f();
+    } catch (...) {
+      const std::lock_guard lock(mutex_);
+      if (!error_) error_ = std::current_exception();
+      stop_ = true;
+      signal();
+    }
+    stats.wall_seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  // Calls `f` on the given buffer, measuring the time it takes.
+  template <typename F>
+  auto timed(StageStats& stats, F f, PipelineBuffer& b) {
+    const Clock::time_point start = Clock::now();
+    const auto done = [&] {
+      stats.busy_seconds +=
+          std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    if constexpr (std::is_void_v<decltype(f(b))>) {
+      f(b);
+      done();
+    } else {
+      const auto r = f(b);
+      done();
+      return r;
+    }
+  }
+
+  static void clear(Queue& q) {
+    while (q.try_pop()) {
+    }
+  }
+
+  // Wakes up the stages sleeping in `wait`, after a push, a pop or a stop.
+  void signal() {
+    progress_.fetch_add(1);
+    if (sleepers_ > 0) progress_.notify_all();
+  }
+
+  // Calls `f` until it succeeds, returning its result, or until the pipeline
+  // stops, returning a default value.
+  template <typename F>
+  auto wait(F f) {
+    for (int attempts = 0;; ++attempts) {
+      // Any change after this load makes the sleep below return at once.
+      const std::uint32_t seen = progress_;
+      if (auto r = f()) {
+        signal();
+        return r;
+      }
+
+      if (stop_) return decltype(f())();
+      if (attempts < spin_count) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      ++sleepers_;
+      progress_.wait(seen);
+      --sleepers_;
+    }
+  }
+
+  // Pushes `i` to `q`, waiting while the queue is full. Returns false if the
+  // pipeline is stopping.
+  bool push(Queue& q, std::size_t i) {
+    return wait([&] { return q.try_push(i); });
+  }
+
+  // Pops an index from `q`, waiting while the queue is empty. Returns nothing
+  // if the pipeline is stopping.
+  std::optional<std::size_t> pop(Queue& q) {
+    return wait([&] { return q.try_pop(); });
+  }
+
+  void reader(const Reader& read) {
+    const std::size_t workers = to_workers_.size();
+    std::size_t index = 0;
+    while (true) {
+      const std::optional<std::size_t> i = pop(free_);
+      if (!i) return;
+
+      PipelineBuffer& b = buffers_[*i];
+      b.index = index;
+      b.size = 0;
+      if (!timed(stats_.front(), read, b)) break;
+      if (!push(*to_workers_[index++ % workers], *i)) return;
+    }
+
+    for (const std::unique_ptr<Queue>& q : to_workers_) {
+      if (!push(*q, end)) return;
+    }
+  }
+
+  void worker(std::size_t w, const Worker& work) {
+    while (true) {
+      const std::optional<std::size_t> i = pop(*to_workers_[w]);
+      if (!i) return;
+      if (*i != end) timed(stats_[w + 1], work, buffers_[*i]);
+      if (!push(*from_workers_[w], *i) || *i == end) return;
+    }
+  }
+
+  void writer(const Writer& write) {
+    const std::size_t workers = from_workers_.size();
+    for (std::size_t index = 0;; ++index) {
+      const std::optional<std::size_t> i = pop(*from_workers_[index % workers]);
+      if (!i || *i == end) return;
+      timed(stats_.back(), write, buffers_[*i]);
+      if (!push(free_, *i)) return;
+    }
+  }
+
+  const std::size_t stride_;
+  const PageBuffer memory_;
+  std::vector<PipelineBuffer> buffers_;
+
+  // Buffers returned by the writer to the reader.
+  Queue free_;
+
+  // Buffers sent by the reader to each worker, and by each worker to the
+  // writer.
+  std::vector<std::unique_ptr<Queue>> to_workers_;
+  std::vector<std::unique_ptr<Queue>> from_workers_;
+
+  std::vector<StageStats> stats_;
+  std::atomic<bool> stop_ = false;
+
+  // Number of pushes, pops and stops so far, and number of stages sleeping
+  // until it changes.
+  std::atomic<std::uint32_t> progress_ = 0;
+  std::atomic<int> sleepers_ = 0;
+
+  std::mutex mutex_;
+  std::exception_ptr error_;
+};
+
+// Maximum number of bytes of the buffers used by `split_file_pipelined`.
+constexpr std::size_t pipeline_memory_limit = std::size_t(256) << 20;
+
+// Splits a file like `split_file`, but through a Pipeline with `workers` worker
+// threads. The reader stage reads windows of the secret, the workers compute
+// the shares and their checksums, and the writer stage writes them. This
+// overlaps the I/O with the computations, and spreads the computations across
+// several cores.
+//
+// Returns the statistics of the pipeline stages.
+//
+// Precondition: 2 <= k <= outputs.size() <= GF::max
+inline std::vector<StageStats> split_file_pipelined(
+    const std::string& input, int k, std::span<const std::string> outputs,
+    std::size_t workers = std::max(1u, std::thread::hardware_concurrency())) {
+  const int n = outputs.size();
+
+  // Computed once for all the windows. Also checks the parameters.
+  const SplitCoefficients cs(k, n);
+
+  const File in(input, O_RDONLY);
+  const std::size_t m = in.size();
+
+  std::vector<ShareFileWriter> files;
+  files.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    ShareFileHeader h;
+    h.x = GF(i + 1);
+    h.threshold = k;
+    h.chunk_size = share_file_chunk_size;
+    h.size = m;
+    h.data_offset = share_file_header_size;
+    files.emplace_back(outputs[i], h);
+  }
+
+  // Each buffer holds a window of the secret, followed by the corresponding
+  // windows of the shares. To stay within `pipeline_memory_limit` with many
+  // shares or workers, the windows shrink down to a single chunk, and then
+  // the buffers get fewer.
+  constexpr std::size_t c = share_file_chunk_size;
+  std::size_t buffers = 2 * workers + 2;
+  const std::size_t w = std::clamp(
+      pipeline_memory_limit / ((n + 1) * buffers) / c * c, c, io_window_size);
+  buffers = std::clamp(pipeline_memory_limit / ((n + 1) * w), std::size_t(1),
+                       buffers);
+  Pipeline pipeline((n + 1) * w, buffers, workers);
+
+  const auto windows = [n, w](const PipelineBuffer& b) {
+    std::vector<std::span<GF>> ys;
+    for (int i = 0; i <= n; ++i) ys.push_back(b.data.subspan(i * w, b.size));
+    return ys;
+  };
+
+  pipeline.run(
+      [&](PipelineBuffer& b) {
+        const std::size_t pos = b.index * w;
+        if (pos >= m) return false;
+        b.size = std::min(w, m - pos);
+        in.read_at(std::as_writable_bytes(b.data.first(b.size)), pos);
+        return true;
+      },
+      [&](PipelineBuffer& b) {
+        const std::vector<std::span<GF>> ys = windows(b);
+        split(ys[0], cs, std::span(ys).subspan(1), fill_random);
+
+        // Each window covers different chunks, so the workers update
+        // different checksums.
+        for (int i = 0; i < n; ++i) {
+          files[i].add_checksums(ys[i + 1], b.index * w);
+        }
+      },
+      [&](PipelineBuffer& b) {
+        const std::vector<std::span<GF>> ys = windows(b);
+        for (int i = 0; i < n; ++i) {
+          files[i].file().write_at(std::as_bytes(ys[i + 1]),
+                                   files[i].header().data_offset + b.index * w);
+        }
+      });
+
+  for (const ShareFileWriter& f : files) f.finish();
+  return pipeline.stats();
+}
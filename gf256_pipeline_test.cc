@@ -0,0 +1,173 @@
+#include "gf256_pipeline.h"
+
+#include <unistd.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gf256_test_util.h"
+
+namespace {
+
+// Temporary directory deleted at the end of the test.
+class TempDir {
+ public:
+  TempDir() {
+    std::string tmpl =
+        (std::filesystem::temp_directory_path() / "gf256_test.XXXXXX");
+    if (!::mkdtemp(tmpl.data())) throw_errno("Cannot create temp dir");
+    path_ = tmpl;
+  }
+
+  ~TempDir() { std::filesystem::remove_all(path_); }
+
+  std::string operator/(const std::string& name) const {
+    return path_ / name;
+  }
+
+ private:
+  std::filesystem::path path_;
+};
+
+void write_file(const std::string& path, std::span<const GF> data) {
+  const File f(path, O_WRONLY | O_CREAT | O_TRUNC);
+  f.write_at(std::as_bytes(data), 0);
+}
+
+std::vector<GF> read_file(const std::string& path) {
+  const File f(path, O_RDONLY);
+  std::vector<GF> data(f.size());
+  f.read_at(std::as_writable_bytes(std::span(data)), 0);
+  return data;
+}
+
+}  // namespace
+
+TEST(GF256Pipeline, SpscQueue) {
+  SpscQueue<int> q(3);
+  EXPECT_FALSE(q.try_pop());
+  for (int i = 0; i < 4; ++i) EXPECT_TRUE(q.try_push(i));
+  EXPECT_FALSE(q.try_push(4));
+  EXPECT_EQ(q.try_pop(), 0);
+  EXPECT_TRUE(q.try_push(4));
+  for (int i = 1; i <= 4; ++i) EXPECT_EQ(q.try_pop(), i);
+  EXPECT_FALSE(q.try_pop());
+
+  // Items arrive in order across threads.
+  const int n = 100000;
+  SpscQueue<int> r(16);
+  std::thread producer([&] {
+    for (int i = 0; i < n; ++i) {
+      while (!r.try_push(i)) std::this_thread::yield();
+    }
+  });
+
+  for (int i = 0; i < n; ++i) {
+    std::optional<int> x;
+    while (!(x = r.try_pop())) std::this_thread::yield();
+    ASSERT_EQ(*x, i);
+  }
+
+  producer.join();
+}
+
+TEST(GF256Pipeline, Pipeline) {
+  const size_t page_size = ::sysconf(_SC_PAGESIZE);
+  Pipeline pipeline(100, 4, 3);
+  std::vector<size_t> out;
+  pipeline.run(
+      [&](PipelineBuffer& b) {
+        if (b.index == 50) return false;
+        // Every buffer starts on a page boundary, for O_DIRECT.
+        EXPECT_EQ(
+            reinterpret_cast<std::uintptr_t>(b.data.data()) % page_size, 0);
+        EXPECT_EQ(b.data.size(), 100);
+        b.size = 1;
+        b.data[0] = GF(b.index);
+        return true;
+      },
+      [](PipelineBuffer& b) { b.data[0] *= GF(2); },
+      [&](PipelineBuffer& b) {
+        ASSERT_EQ(b.size, 1);
+        out.push_back(b.index);
+        EXPECT_EQ(b.data[0], GF(b.index) * GF(2));
+      });
+
+  // The writer receives the buffers in order.
+  std::vector<size_t> want(50);
+  for (size_t i = 0; i < want.size(); ++i) want[i] = i;
+  EXPECT_EQ(out, want);
+
+  const std::vector<StageStats>& stats = pipeline.stats();
+  ASSERT_EQ(stats.size(), 5);
+  EXPECT_EQ(stats.front().name, "reader");
+  EXPECT_EQ(stats.back().name, "writer");
+  for (const StageStats& s : stats) {
+    EXPECT_GE(s.utilization(), 0);
+    EXPECT_LE(s.utilization(), 1);
+  }
+
+  // Exceptions thrown by any stage stop the pipeline.
+  EXPECT_THROW(pipeline.run([](PipelineBuffer&) { return true; },
+                            [](PipelineBuffer& b) {
+                              if (b.index == 10) throw std::runtime_error("");
+                            },
+                            [](PipelineBuffer&) {}),
+               std::runtime_error);
+}
+
+TEST(GF256Pipeline, IdleStagesSleep) {
+  // The workers and the writer wait for a slow reader without spinning.
+  Pipeline pipeline(100, 4, 3);
+  const std::clock_t cpu = std::clock();
+  const auto start = std::chrono::steady_clock::now();
+  pipeline.run(
+      [](PipelineBuffer& b) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return b.index < 10;
+      },
+      [](PipelineBuffer&) {}, [](PipelineBuffer&) {});
+
+  const std::chrono::duration<double> wall =
+      std::chrono::steady_clock::now() - start;
+  EXPECT_LT(double(std::clock() - cpu) / CLOCKS_PER_SEC, wall.count() / 2);
+}
+
+TEST(GF256Pipeline, SplitFilePipelined) {
+  const TempDir dir;
+
+  for (const size_t m : {size_t(0), size_t(1000), 5 * io_window_size + 123}) {
+    const std::vector<GF> secret = random_bytes(m);
+    write_file(dir / "secret", secret);
+
+    const std::vector<std::string> shares = {dir / "s1", dir / "s2",
+                                             dir / "s3", dir / "s4"};
+    const std::vector<StageStats> stats =
+        split_file_pipelined(dir / "secret", 3, shares, 2);
+    EXPECT_EQ(stats.size(), 4);
+
+    for (int i = 0; i < 4; ++i) {
+      const ShareFileReader reader(shares[i]);
+      const ShareFileHeader& h = reader.header();
+      EXPECT_EQ(h.x, GF(i + 1));
+      EXPECT_EQ(h.size, m);
+    }
+
+    const std::vector<std::string> in = {shares[3], shares[0], shares[2]};
+    combine_files(in, dir / "out");
+    EXPECT_EQ(read_file(dir / "out"), secret);
+  }
+
+  EXPECT_THROW(split_file_pipelined(dir / "secret", 3, {}),
+               std::runtime_error);
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "gf256_io.h"
+
+// Repair of a lost share from `k` helper shares, with each helper running in
+// its own process and sending its data over a local socket.
+//
+// In the star mode, the helpers send their raw shares to the repaired node,
+// which interpolates them. Its incoming link then carries `k` times the size of
+// a share.
+//
+// In the chain mode, the helpers form a chain ending at the repaired node. The
+// share is split into slices, and each helper adds its weighted contribution
+// (see `lagrange_weight`) to the partial sum of each slice received from the
+// previous helper before forwarding it to the next one. Every link then
+// carries the size of a single share, and since the slices are pipelined along
+// the chain, the repair takes about as long as a single transfer.
+
+// Number of bytes of each slice sent over the links.
+constexpr std::size_t repair_slice_size = std::size_t(64) << 10;
+
+enum class RepairMode { star, chain };
+
+// Measurements of a repair.
+struct RepairStats {
+  // Time between the start of the helpers and the completion of the repair.
+  double seconds = 0;
+
+  // Number of bytes sent by each helper.
+  std::vector<std::size_t> link_bytes;
+
+  // Number of bytes received by the repaired node.
+  std::size_t received_bytes = 0;
+};
+
+// Reconstructs the share at `dest_x` from the `helpers` shares, and writes its
+// `y` values to `out`. Each helper runs in a child process, and the data flows
+// through local sockets according to the given `mode`.
+//
+// Returns the duration of the repair and the number of bytes sent over each
+// link.
+//
+// Precondition: helpers.size() >= 2
+// Precondition: helpers[i].x != helpers[j].x for i != j
+// Precondition: helpers[i].ys.size() == out.size() for each i
+inline RepairStats repair(std::span<const Share> helpers, GF dest_x,
+                          std::span<GF> out, RepairMode mode,
+                          std::size_t slice_size = repair_slice_size) {
+  using namespace gf256_internal;
+  if (slice_size == 0) throw std::runtime_error("Invalid slice size");
+
+  const std::size_t k = helpers.size();
+  const std::size_t m = out.size();
+  std::vector<GF> xs;
+  xs.reserve(k);
+  for (const Share& s : helpers) {
+    if (s.ys.size() != m) {
+      throw std::runtime_error(
+          "All the shares must have the same number of y values");
+    }
+
+    xs.push_back(s.x);
+  }
+
+  // Also checks that the x values are distinct.
+  const std::vector<GF> cs = lagrange_coefficients(xs, dest_x);
+
+  // Link `i` starts at the helper `i`. Its receiving end is links[i][0], and
+  // its sending end is links[i][1].
+  std::vector<std::array<File, 2>> links(k);
+  for (std::array<File, 2>& link : links) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+      throw_errno("Cannot create socket pair");
+    }
+
+    link[0] = File(fds[0]);
+    link[1] = File(fds[1]);
+  }
+
+  // Byte counters updated by the helpers.
+  const PageBuffer counters(k * sizeof(std::uint64_t), true);
+  std::uint64_t* const sent =
+      reinterpret_cast<std::uint64_t*>(counters.span().data());
+
+  // Allocated before forking, so that the helpers don't need to allocate.
+  std::vector<GF> buf(std::min(slice_size, m));
+
+  const auto help = [&](const std::size_t i) {
+    const std::span<const GF> ys = helpers[i].ys;
+    const int to = links[i][1].fd();
+    const int from = i > 0 ? links[i - 1][0].fd() : -1;
+    const GF w = lagrange_weight(xs, xs[i], dest_x);
+
+    for (std::size_t pos = 0; pos < m; pos += slice_size) {
+      const std::size_t len = std::min(slice_size, m - pos);
+      if (mode == RepairMode::star) {
+        write_full(to, std::as_bytes(ys.subspan(pos, len)));
+      } else {
+        const std::span<GF> partial = std::span(buf).first(len);
+        if (from < 0) {
+          mul(partial, w, ys.subspan(pos, len));
+        } else {
+          read_full(from, std::as_writable_bytes(partial));
+          mul_add(partial, w, ys.subspan(pos, len));
+        }
+
+        write_full(to, std::as_bytes(partial));
+      }
+
+      sent[i] += len;
+    }
+  };
+
+  std::vector<pid_t> pids;
+  const auto wait_all = [&] {
+    bool ok = true;
+    for (const pid_t pid : pids) {
+      int status = 0;
+      pid_t r;
+      while ((r = ::waitpid(pid, &status, 0)) < 0 && errno == EINTR) {
+      }
+      ok = ok && r == pid && WIFEXITED(status) &&
+           WEXITSTATUS(status) == EXIT_SUCCESS;
+    }
+
+    pids.clear();
+    return ok;
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+
+  // Number of bytes read by the repaired node from the links.
+  std::size_t received = 0;
+  try {
+    for (std::size_t i = 0; i < k; ++i) {
+      const pid_t pid = ::fork();
+      if (pid < 0) throw_errno("Cannot fork");
+
+      if (pid == 0) {
+        // Only keep the ends of the links used by this helper, so that the
+        // next node gets an end of stream if this helper fails.
+        for (std::size_t j = 0; j < k; ++j) {
+          if (j != i) ::close(links[j][1].fd());
+          if (mode == RepairMode::star || j + 1 != i) {
+            ::close(links[j][0].fd());
+          }
+        }
+
+        int code = EXIT_SUCCESS;
+        try {
+          help(i);
+        } catch (...) {
+          code = EXIT_FAILURE;
+        }
+
+        ::_exit(code);
+      }
+
+      pids.push_back(pid);
+    }
+
+    for (std::array<File, 2>& link : links) link[1] = File();
+
+    for (std::size_t pos = 0; pos < m; pos += slice_size) {
+      const std::size_t len = std::min(slice_size, m - pos);
+      const std::span<GF> dst = out.subspan(pos, len);
+      if (mode == RepairMode::chain) {
+        read_full(links[k - 1][0].fd(), std::as_writable_bytes(dst));
+        received += len;
+        continue;
+      }
+
+      const std::span<GF> src = std::span(buf).first(len);
+      std::fill(dst.begin(), dst.end(), GF(0));
+      for (std::size_t i = 0; i < k; ++i) {
+        read_full(links[i][0].fd(), std::as_writable_bytes(src));
+        received += len;
+        mul_add(dst, cs[i], src);
+      }
+    }
+  } catch (...) {
+    links.clear();
+    wait_all();
+    throw;
+  }
+
+  if (!wait_all()) throw std::runtime_error("Repair helper failed");
+
+  RepairStats stats;
+  stats.seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  stats.link_bytes.assign(sent, sent + k);
+  stats.received_bytes = received;
+  return stats;
+}
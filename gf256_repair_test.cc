@@ -0,0 +1,72 @@
+#include "gf256_repair.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "gf256_test_util.h"
+
+TEST(GF256Repair, Repair) {
+  for (const size_t m : {size_t(0), size_t(1000), 3 * repair_slice_size + 17}) {
+    std::vector<GF> secret(m);
+    fill_pseudo_random(secret);
+    const std::vector<Share> shares = split(secret, 3, 5, fill_pseudo_random);
+
+    // Repair the share 4 from the shares 5, 1 and 2.
+    const std::vector<Share> helpers = {shares[4], shares[0], shares[1]};
+    for (const RepairMode mode : {RepairMode::star, RepairMode::chain}) {
+      for (const size_t slice_size : {size_t(100), repair_slice_size}) {
+        std::vector<GF> out(m);
+        const RepairStats stats =
+            repair(helpers, GF(4), out, mode, slice_size);
+        EXPECT_EQ(out, shares[3].ys);
+        EXPECT_GE(stats.seconds, 0);
+
+        // Each link carries the size of a share.
+        EXPECT_THAT(stats.link_bytes, testing::Each(m));
+        EXPECT_EQ(stats.received_bytes, mode == RepairMode::star ? 3 * m : m);
+      }
+
+      std::vector<GF> out(m);
+      repair(helpers, GF(0), out, mode);
+      EXPECT_EQ(out, secret);
+    }
+  }
+
+  std::vector<GF> out(10);
+  const std::vector<Share> bad = {{GF(1), std::vector<GF>(10)},
+                                  {GF(2), std::vector<GF>(9)}};
+  EXPECT_THROW(repair(bad, GF(0), out, RepairMode::chain), std::runtime_error);
+  const std::vector<Share> dup = {{GF(1), std::vector<GF>(10)},
+                                  {GF(1), std::vector<GF>(10)}};
+  EXPECT_THROW(repair(dup, GF(0), out, RepairMode::chain), std::runtime_error);
+  EXPECT_THROW(repair(std::span(dup).first(1), GF(0), out, RepairMode::star),
+               std::runtime_error);
+}
+
+TEST(GF256Repair, ShortChains) {
+  std::vector<GF> secret(333);
+  fill_pseudo_random(secret);
+  const std::vector<Share> shares = split(secret, 2, 3, fill_pseudo_random);
+
+  // A single helper cannot repair a share, even when it holds it.
+  std::vector<GF> out(secret.size());
+  EXPECT_THROW(
+      repair(std::span(shares).first(1), GF(2), out, RepairMode::chain),
+      std::runtime_error);
+  EXPECT_THROW(
+      repair(std::span(shares).first(1), GF(1), out, RepairMode::chain),
+      std::runtime_error);
+
+  // The shortest chain, with slices of a single value.
+  const std::vector<Share> helpers = {shares[2], shares[0]};
+  RepairStats stats = repair(helpers, GF(2), out, RepairMode::chain, 1);
+  EXPECT_EQ(out, shares[1].ys);
+  EXPECT_EQ(stats.received_bytes, secret.size());
+
+  // Repairing the share of a helper only keeps its own contribution.
+  stats = repair(helpers, GF(1), out, RepairMode::chain);
+  EXPECT_EQ(out, shares[0].ys);
+}
@@ -0,0 +1,70 @@
+// Splits a file into share files using Shamir's secret sharing.
+//
+// Usage: gf256-split [-d] -k THRESHOLD -n SHARES INPUT OUTPUT_PREFIX
+//
+// Writes the share files OUTPUT_PREFIX.001 to OUTPUT_PREFIX.<SHARES>. Any
+// THRESHOLD of them are enough to reconstruct INPUT with gf256-combine.
+//
+// With -d, the files are accessed with direct I/O, bypassing the page cache.
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gf256_io.h"
+
+namespace {
+
+[[noreturn]] void usage() {
+  std::cerr
+      << "Usage: gf256-split [-d] -k THRESHOLD -n SHARES INPUT OUTPUT_PREFIX"
+      << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int k = 0;
+  int n = 0;
+  IoMode mode = IoMode::mapped;
+
+  for (int opt; (opt = ::getopt(argc, argv, "dk:n:")) != -1;) {
+    switch (opt) {
+      case 'd':
+        mode = IoMode::direct;
+        break;
+      case 'k':
+        k = std::atoi(optarg);
+        break;
+      case 'n':
+        n = std::atoi(optarg);
+        break;
+      default:
+        usage();
+    }
+  }
+
+  if (argc - optind != 2 || k <= 0 || n <= 0) usage();
+  const std::string input = argv[optind];
+  const std::string prefix = argv[optind + 1];
+
+  std::vector<std::string> outputs;
+  for (int i = 1; i <= n; ++i) {
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), ".%03d", i);
+    outputs.push_back(prefix + suffix);
+  }
+
+  try {
+    split_file(input, k, outputs, mode);
+  } catch (const std::exception& e) {
+    std::cerr << "gf256-split: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
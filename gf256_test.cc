@@ -3,12 +3,21 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
 #include <concepts>
 #include <iomanip>
 #include <iostream>
 #include <random>
+#include <ranges>
+#include <sstream>
+#include <string>
 #include <type_traits>
 
+#include "gf256_test_util.h"
+
 namespace {
 
 // Reference implementation of multiplication in GF(256).
@@ -247,3 +256,829 @@ TEST(GF256, Interpolate) {
     EXPECT_THROW(interpolate(in, GF(255)), std::runtime_error);
   }
 }
+
+TEST(GF256, MulRegion) {
+  std::random_device dev;
+  std::mt19937 rng(dev());
+  std::uniform_int_distribution<int> dist(0, 255);
+
+  // Use an odd size to exercise both the vectorized and the scalar parts.
+  std::vector<GF> src(1000);
+  for (GF& y : src) y = GF(dist(rng));
+
+  for (GF c;; ++c.bits) {
+    std::vector<GF> dst(src.size());
+    mul(dst, c, src);
+    for (size_t i = 0; i < src.size(); ++i) {
+      EXPECT_EQ(dst[i], c * src[i]);
+    }
+
+    std::vector<GF> acc = src;
+    mul_add(acc, c, src);
+    for (size_t i = 0; i < src.size(); ++i) {
+      EXPECT_EQ(acc[i], src[i] + c * src[i]);
+    }
+
+    if (c == GF(GF::max)) break;
+  }
+}
+
+TEST(GF256, Dot) {
+  std::random_device dev;
+  std::mt19937 rng(dev());
+  std::uniform_int_distribution<int> dist(0, 255);
+
+  // Use a size spanning several tiles.
+  const size_t m = 10000;
+  std::vector<std::vector<GF>> regions(5, std::vector<GF>(m));
+  std::vector<GF> cs;
+  for (std::vector<GF>& r : regions) {
+    for (GF& y : r) y = GF(dist(rng));
+    cs.push_back(GF(dist(rng)));
+  }
+
+  // Include a zero coefficient.
+  cs[2] = GF(0);
+
+  const std::vector<std::span<const GF>> srcs(regions.begin(), regions.end());
+  std::vector<GF> dst(m, GF(42));
+  dot(dst, cs, srcs);
+
+  for (size_t j = 0; j < m; ++j) {
+    GF want;
+    for (size_t i = 0; i < cs.size(); ++i) want += cs[i] * regions[i][j];
+    EXPECT_EQ(dst[j], want);
+  }
+}
+
+TEST(GF256, LagrangeCoefficients) {
+  const GF xs[] = {GF(1), GF(2), GF(3), GF(4)};
+
+  // The coefficients evaluate any polynomial of degree 3 at dest_x.
+  const GF p[] = {GF(7), GF(13), GF(200), GF(99)};
+  const auto eval = [&p](GF x) {
+    GF y;
+    for (int i = 3; i >= 0; --i) y = y * x + p[i];
+    return y;
+  };
+
+  for (GF dest_x;; ++dest_x.bits) {
+    const std::vector<GF> cs = lagrange_coefficients(xs, dest_x);
+    ASSERT_EQ(cs.size(), 4);
+    GF y;
+    for (int i = 0; i < 4; ++i) y += cs[i] * eval(xs[i]);
+    EXPECT_EQ(y, eval(dest_x));
+    if (dest_x == GF(GF::max)) break;
+  }
+
+  // Evaluating at one of the xs gives a unit vector.
+  EXPECT_THAT(lagrange_coefficients(xs, GF(3)),
+              testing::ElementsAre(GF(0), GF(0), GF(1), GF(0)));
+
+  EXPECT_THROW(lagrange_coefficients({xs, 1}, GF(0)), std::runtime_error);
+  const GF dups[] = {GF(1), GF(2), GF(1)};
+  EXPECT_THROW(lagrange_coefficients(dups, GF(0)), std::runtime_error);
+}
+
+TEST(GF256, SplitCoefficients) {
+  const SplitCoefficients cs(3, 6);
+  EXPECT_EQ(cs.k(), 3);
+  EXPECT_EQ(cs.n(), 6);
+  const std::vector<GF> xs = {GF(0), GF(1), GF(2)};
+  for (int x = 3; x <= 6; ++x) {
+    EXPECT_TRUE(
+        std::ranges::equal(cs.row(x), lagrange_coefficients(xs, GF(x))));
+  }
+
+  // The same coefficients split all the pieces of a secret.
+  std::vector<GF> secret(1000);
+  fill_pseudo_random(secret);
+  std::vector<Share> shares(6);
+  for (int i = 0; i < 6; ++i) {
+    shares[i].x = GF(i + 1);
+    shares[i].ys.resize(secret.size());
+  }
+  for (size_t pos = 0; pos < secret.size(); pos += 300) {
+    const size_t len = std::min<size_t>(300, secret.size() - pos);
+    std::vector<std::span<GF>> ys;
+    for (Share& s : shares) ys.push_back(std::span(s.ys).subspan(pos, len));
+    split(std::span(secret).subspan(pos, len), cs, ys, fill_pseudo_random);
+  }
+  EXPECT_EQ(interpolate(std::span(shares).last(3), GF(0)).ys, secret);
+  EXPECT_EQ(interpolate(std::span(shares).first(3), GF(0)).ys, secret);
+
+  std::vector<std::span<GF>> five;
+  for (int i = 0; i < 5; ++i) five.push_back(shares[i].ys);
+  EXPECT_THROW(split(secret, cs, five, fill_pseudo_random),
+               std::runtime_error);
+  EXPECT_THROW(SplitCoefficients(1, 5), std::runtime_error);
+  EXPECT_THROW(SplitCoefficients(3, 2), std::runtime_error);
+  EXPECT_THROW(SplitCoefficients(3, 256), std::runtime_error);
+}
+
+TEST(GF256, ReconstructRange) {
+  std::random_device dev;
+  std::mt19937 rng(dev());
+  std::uniform_int_distribution<int> dist(0, 255);
+
+  // Start with 3 random shares, and interpolate the secret at x = 0.
+  const size_t m = 100000;
+  std::vector<Share> shares;
+  for (int i = 1; i <= 3; ++i) {
+    Share& s = shares.emplace_back();
+    s.x = GF(i);
+    s.ys.resize(m);
+    for (GF& y : s.ys) y = GF(dist(rng));
+  }
+
+  const Share secret = interpolate(shares, GF(0));
+
+  // Sources counting the number of values read.
+  size_t count = 0;
+  std::vector<ShareSource> sources;
+  for (const Share& s : shares) {
+    sources.push_back({s.x, [&s, &count](size_t pos, std::span<GF> out) {
+                         count += out.size();
+                         make_source(s).read(pos, out);
+                       }});
+  }
+
+  const RangeReconstructor r(sources);
+  EXPECT_EQ(r.dest_x(), GF(0));
+  for (const size_t pos : {size_t(0), size_t(1), size_t(4095), m - 10}) {
+    for (const size_t len : {size_t(0), size_t(1), size_t(10), size_t(5000)}) {
+      if (pos + len > m) continue;
+      count = 0;
+      EXPECT_TRUE(std::ranges::equal(r.read(pos, len),
+                                     std::span(secret.ys).subspan(pos, len)));
+      EXPECT_EQ(count, 3 * len);
+    }
+  }
+
+  // Reconstruct the whole share in one go.
+  EXPECT_EQ(reconstruct_range(sources, 0, m), secret.ys);
+
+  // Reconstructing one of the source shares only reads this share.
+  count = 0;
+  EXPECT_EQ(reconstruct_range(sources, 10, 20, GF(2)),
+            std::vector<GF>(shares[1].ys.begin() + 10,
+                            shares[1].ys.begin() + 30));
+  EXPECT_EQ(count, 20);
+
+  EXPECT_THROW(r.read(m - 1, 2), std::out_of_range);
+  EXPECT_THROW(reconstruct_range({sources.data(), 1}, 0, 1),
+               std::runtime_error);
+
+  // The sources are validated once, at construction.
+  std::vector<ShareSource> bad = sources;
+  bad[1].read = nullptr;
+  EXPECT_THROW(RangeReconstructor(bad, GF(0)), std::runtime_error);
+  bad[1] = bad[0];
+  EXPECT_THROW(RangeReconstructor(bad, GF(0)), std::runtime_error);
+
+  // The sources with a zero coefficient are dropped at construction, even
+  // when they cannot be read.
+  bad = sources;
+  bad[0].read = [](size_t, std::span<GF>) { throw std::logic_error("read"); };
+  const RangeReconstructor one(bad, GF(3));
+  EXPECT_EQ(one.read(5, 7), std::vector<GF>(shares[2].ys.begin() + 5,
+                                            shares[2].ys.begin() + 12));
+}
+
+TEST(GF256, InterpolateViews) {
+  std::random_device dev;
+  std::mt19937 rng(dev());
+  std::uniform_int_distribution<int> dist(0, 255);
+
+  // Shares stored in a single external buffer, one after the other.
+  const size_t m = 1000;
+  std::vector<std::byte> buf(3 * m);
+  for (std::byte& b : buf) b = std::byte(dist(rng));
+
+  std::vector<Share> shares;
+  std::vector<ShareView> views;
+  for (int i = 0; i < 3; ++i) {
+    const std::span<const std::byte> ys = std::span(buf).subspan(i * m, m);
+    views.push_back({GF(i + 1), ys});
+    Share& s = shares.emplace_back();
+    s.x = GF(i + 1);
+    for (const std::byte b : ys) s.ys.push_back(GF(b));
+  }
+
+  for (const int x : {0, 1, 3, 200}) {
+    std::vector<std::byte> out(m);
+    interpolate(views, GF(x), out);
+    const Share want = interpolate(shares, GF(x));
+    EXPECT_TRUE(std::ranges::equal(std::as_bytes(std::span(want.ys)), out));
+  }
+
+  std::vector<std::byte> out(m - 1);
+  EXPECT_THROW(interpolate(views, GF(0), out), std::runtime_error);
+  EXPECT_THROW(interpolate(views, GF(0), std::span(buf).subspan(m / 2, m)),
+               std::runtime_error);
+  EXPECT_THROW(interpolate(std::span(views).first(1), GF(0), out),
+               std::runtime_error);
+}
+
+TEST(GF256, Hex) {
+  std::random_device dev;
+  std::mt19937 rng(dev());
+  std::uniform_int_distribution<int> dist(0, 255);
+
+  EXPECT_EQ(hex_size(0), 0);
+  EXPECT_EQ(hex_size(1), 2);
+  EXPECT_EQ(hex_size(3), 8);
+
+  // Sizes around the vector width.
+  for (const size_t m : {0, 1, 15, 16, 17, 32, 33, 1000, 3000}) {
+    Share s;
+    s.x = GF(dist(rng));
+    s.ys.resize(m);
+    for (GF& y : s.ys) y = GF(dist(rng));
+
+    // Reference implementation of the textual format.
+    std::ostringstream want;
+    want << "{x: " << s.x << ", ys: [";
+    for (size_t i = 0; i < m; ++i) want << (i ? " " : "") << s.ys[i];
+    want << "]}";
+
+    std::ostringstream out;
+    out << s;
+    EXPECT_EQ(out.str(), want.str());
+    EXPECT_EQ(parse_share(out.str()), s);
+
+    std::string hex(hex_size(m), '?');
+    to_hex(s.ys, hex);
+    EXPECT_EQ(from_hex(hex), s.ys);
+
+    // Lowercase digits are accepted.
+    for (char& c : hex) c = std::tolower(c);
+    EXPECT_EQ(from_hex(hex), s.ys);
+
+    // Malformed values are rejected.
+    for (size_t i = 0; i < hex.size(); i += 7) {
+      std::string bad = hex;
+      bad[i] = i % 3 == 2 ? ',' : 'g';
+      EXPECT_THROW(from_hex(bad), std::runtime_error);
+    }
+  }
+
+  EXPECT_EQ(parse_share("{x: 0a, ys: []}"), (Share{GF(10), {}}));
+  EXPECT_THROW(parse_share("{x: 0a, ys: [12 3]}"), std::runtime_error);
+  EXPECT_THROW(parse_share("{x: 0a, ys: [12 34}"), std::runtime_error);
+  EXPECT_THROW(parse_share("{x: 0a ys: [12 34]}"), std::runtime_error);
+  EXPECT_THROW(parse_share("{x: 0, ys: []}"), std::runtime_error);
+
+  // Read shares from a stream.
+  std::istringstream in("{x: 01, ys: [AB CD]}\n  {x: 02, ys: []}{x: 3}");
+  Share s;
+  EXPECT_TRUE(in >> s);
+  EXPECT_EQ(s, (Share{GF(1), {GF(0xAB), GF(0xCD)}}));
+  EXPECT_TRUE(in >> s);
+  EXPECT_EQ(s, (Share{GF(2), {}}));
+  EXPECT_FALSE(in >> s);
+}
+
+TEST(GF256, ShareBatch) {
+  // Many keys of 16 bytes.
+  const size_t count = 1000;
+  const size_t size = 16;
+  std::vector<std::vector<GF>> keys(count, std::vector<GF>(size));
+  ShareBatch secrets(GF(0), count, size);
+  EXPECT_EQ(secrets.item_size(), size);
+  for (size_t i = 0; i < count; ++i) {
+    fill_pseudo_random(keys[i]);
+    secrets.set(i, keys[i]);
+  }
+
+  const std::vector<ShareBatch> shares =
+      split_batch(secrets, 3, 5, fill_pseudo_random);
+  ASSERT_EQ(shares.size(), 5);
+
+  // The batches hold the same shares as the ones of each key.
+  for (size_t i = 0; i < count; i += 99) {
+    std::vector<Share> s(5);
+    for (int j = 0; j < 5; ++j) {
+      EXPECT_EQ(shares[j].x, GF(j + 1));
+      EXPECT_EQ(shares[j].count, count);
+      s[j] = {shares[j].x, shares[j].get(i)};
+    }
+
+    EXPECT_EQ(interpolate(std::span(s).first(3), GF(0)).ys, keys[i]);
+    EXPECT_EQ(interpolate(std::span(s).last(3), GF(0)).ys, keys[i]);
+  }
+
+  // Any three batches of shares reconstruct the keys.
+  const std::vector<ShareBatch> some = {shares[4], shares[1], shares[2]};
+  EXPECT_EQ(interpolate_batch(some, GF(0)), secrets);
+  EXPECT_EQ(interpolate_batch(some, GF(4)), shares[3]);
+
+  const std::vector<ShareBatch> bad = {shares[0], ShareBatch(GF(2), 1, size)};
+  EXPECT_THROW(interpolate_batch(bad, GF(0)), std::runtime_error);
+  EXPECT_THROW(interpolate_batch(std::span(some).first(1), GF(0)),
+               std::runtime_error);
+}
+
+TEST(GF256, CoefficientBank) {
+  const CoefficientBank bank(7, 3);
+  EXPECT_EQ(bank.n(), 7);
+  EXPECT_EQ(bank.k(), 3);
+
+  // Each set of 3 shares among 7 has a distinct rank.
+  std::vector<bool> seen(35);
+  for (std::uint64_t subset = 0; subset < 128; ++subset) {
+    if (std::popcount(subset) != 3) {
+      EXPECT_THROW(bank.coefficients(subset, GF(0)), std::out_of_range);
+      continue;
+    }
+
+    const std::uint64_t r = bank.rank(subset);
+    ASSERT_LT(r, seen.size());
+    EXPECT_FALSE(seen[r]);
+    seen[r] = true;
+
+    std::vector<GF> xs;
+    for (int x = 1; x <= 7; ++x) {
+      if (subset >> (x - 1) & 1) xs.push_back(GF(x));
+    }
+
+    for (int dest_x = 0; dest_x <= 8; ++dest_x) {
+      if (dest_x == 8 || (dest_x > 0 && subset >> (dest_x - 1) & 1)) {
+        EXPECT_THROW(bank.coefficients(subset, GF(dest_x)), std::out_of_range);
+        continue;
+      }
+
+      EXPECT_TRUE(std::ranges::equal(bank.coefficients(subset, GF(dest_x)),
+                                     lagrange_coefficients(xs, GF(dest_x))));
+    }
+  }
+
+  EXPECT_THROW(bank.coefficients(0b10000011, GF(0)), std::out_of_range);
+
+  // Interpolate shares in any order.
+  std::vector<GF> secret(100);
+  fill_pseudo_random(secret);
+  const std::vector<Share> shares = split(secret, 3, 7, fill_pseudo_random);
+  const std::vector<Share> some = {shares[5], shares[1], shares[3]};
+  EXPECT_EQ(bank.interpolate(some, GF(0)).ys, secret);
+  EXPECT_EQ(bank.interpolate(some, GF(7)), shares[6]);
+  EXPECT_THROW(bank.interpolate(some, GF(2)), std::out_of_range);
+  EXPECT_THROW(bank.interpolate(std::span(shares).first(4), GF(0)),
+               std::out_of_range);
+
+  const std::vector<Share> dup = {shares[5], shares[1], shares[5]};
+  EXPECT_THROW(bank.interpolate(dup, GF(0)), std::out_of_range);
+
+  // Typical and extreme parameters.
+  EXPECT_EQ(CoefficientBank(14, 10).rank(0b11111111110000), 1000);
+  EXPECT_EQ(CoefficientBank(64, 64).rank(~std::uint64_t(0)), 0);
+  EXPECT_THROW(CoefficientBank(5, 1), std::runtime_error);
+  EXPECT_THROW(CoefficientBank(65, 3), std::runtime_error);
+  EXPECT_THROW(CoefficientBank(64, 32), std::runtime_error);
+}
+
+TEST(GF256, PartialSums) {
+  const std::vector<GF> xs = {GF(3), GF(1), GF(7), GF(200)};
+  for (const int dest_x : {0, 1, 2, 7, 255}) {
+    const std::vector<GF> cs = lagrange_coefficients(xs, GF(dest_x));
+    for (size_t i = 0; i < xs.size(); ++i) {
+      EXPECT_EQ(lagrange_weight(xs, xs[i], GF(dest_x)), cs[i]);
+    }
+  }
+
+  EXPECT_THROW(lagrange_weight(xs, GF(4), GF(0)), std::runtime_error);
+  EXPECT_THROW(lagrange_weight({xs.data(), 1}, GF(3), GF(0)),
+               std::runtime_error);
+  const std::vector<GF> dup = {GF(3), GF(1), GF(3)};
+  EXPECT_THROW(lagrange_weight(dup, GF(3), GF(0)), std::runtime_error);
+  // Validated even when another share lies at `dest_x`.
+  EXPECT_THROW(lagrange_weight(xs, GF(4), GF(1)), std::runtime_error);
+  const std::vector<GF> other_dup = {GF(3), GF(1), GF(1)};
+  EXPECT_THROW(lagrange_weight(other_dup, GF(3), GF(1)), std::runtime_error);
+
+  // Region addition.
+  for (const size_t m : {0, 1, 31, 32, 100}) {
+    std::vector<GF> a(m), b(m);
+    fill_pseudo_random(a);
+    fill_pseudo_random(b);
+    std::vector<GF> want(m);
+    for (size_t i = 0; i < m; ++i) want[i] = a[i] + b[i];
+    add(a, b);
+    EXPECT_EQ(a, want);
+  }
+
+  // Each holder of one of 4 shares contributes its weighted share.
+  std::vector<GF> secret(1000);
+  fill_pseudo_random(secret);
+  const std::vector<Share> all = split(secret, 4, 7, fill_pseudo_random);
+  std::vector<Share> parts;
+  for (const GF x : xs) {
+    if (x == GF(200)) continue;
+    parts.push_back(all[x.bits - 1]);
+  }
+  parts.push_back(all[5]);
+
+  std::vector<GF> part_xs;
+  for (const Share& s : parts) part_xs.push_back(s.x);
+  for (Share& s : parts) to_contribution(s, part_xs, GF(0));
+
+  // Sum the contributions along a chain, and along a tree.
+  Share chain = parts[3];
+  for (int i = 2; i >= 0; --i) combine(chain, parts[i]);
+  EXPECT_EQ(chain.x, GF(0));
+  EXPECT_EQ(chain.ys, secret);
+
+  Share left = parts[0], right = parts[2];
+  combine(left, parts[1]);
+  combine(right, parts[3]);
+  combine(right, left);
+  EXPECT_EQ(right.ys, secret);
+
+  Share other = all[0];
+  EXPECT_THROW(combine(chain, other), std::runtime_error);
+  other.x = GF(0);
+  other.ys.pop_back();
+  EXPECT_THROW(combine(chain, other), std::runtime_error);
+}
+
+TEST(GF256, NewtonInterpolator) {
+  std::mt19937 rng(std::random_device{}());
+
+  // Shares of random polynomials of degree 5, arriving in any order.
+  std::vector<GF> secret(1000);
+  fill_pseudo_random(secret);
+  std::vector<Share> shares = split(secret, 6, 10, fill_pseudo_random);
+  std::shuffle(shares.begin(), shares.end(), rng);
+
+  NewtonInterpolator newton(GF(0));
+  NewtonInterpolator repair(shares[9].x);
+  EXPECT_EQ(newton.size(), 0);
+  for (size_t k = 1; k <= 6; ++k) {
+    newton.add(shares[k - 1]);
+    repair.add(shares[k - 1]);
+    EXPECT_EQ(newton.size(), k);
+    EXPECT_EQ(newton.result().x, GF(0));
+
+    // Same result as the Lagrange interpolation of the shares added so far.
+    if (k >= 2) {
+      const std::span<const Share> added = std::span(shares).first(k);
+      EXPECT_EQ(newton.result(), interpolate(added, GF(0)));
+      EXPECT_EQ(newton.evaluate(GF(77)), interpolate(added, GF(77)));
+    }
+  }
+
+  EXPECT_EQ(newton.result().ys, secret);
+  EXPECT_EQ(repair.result(), shares[9]);
+
+  // More shares don't change the result.
+  newton.add(shares[6]);
+  EXPECT_EQ(newton.result().ys, secret);
+  EXPECT_EQ(newton.evaluate(shares[8].x), shares[8]);
+
+  // Adding a known share evaluates to it.
+  NewtonInterpolator at_share(shares[0].x);
+  at_share.add(shares[0]);
+  at_share.add(shares[1]);
+  EXPECT_EQ(at_share.result(), shares[0]);
+
+  EXPECT_THROW(newton.add(shares[2]), std::runtime_error);
+  Share bad = shares[7];
+  bad.ys.pop_back();
+  EXPECT_THROW(newton.add(bad), std::runtime_error);
+  EXPECT_EQ(newton.size(), 7);
+}
+
+TEST(GF256, BarycentricWeights) {
+  for (const int n : {2, 3, 10, 255}) {
+    std::vector<GF> xs;
+    for (int i = 0; i < n; ++i) xs.push_back(GF(255 - i));
+
+    const BarycentricWeights weights(xs);
+    EXPECT_TRUE(std::ranges::equal(weights.xs(), xs));
+
+    // Sweep all the destinations.
+    std::vector<GF> cs(n);
+    for (int dest_x = 0; dest_x <= 255; ++dest_x) {
+      weights.coefficients(GF(dest_x), cs);
+      EXPECT_EQ(cs, lagrange_coefficients(xs, GF(dest_x)));
+    }
+
+    EXPECT_EQ(weights.coefficients(GF(1)), lagrange_coefficients(xs, GF(1)));
+  }
+
+  const std::vector<GF> dup = {GF(1), GF(2), GF(1)};
+  EXPECT_THROW(BarycentricWeights{dup}, std::runtime_error);
+  EXPECT_THROW(BarycentricWeights(std::span(dup).first(1)),
+               std::runtime_error);
+}
+
+TEST(GF256, PackedSharing) {
+  std::mt19937 rng(std::random_device{}());
+
+  // Sizes that are not multiples of the number of blocks.
+  for (const size_t m : {0, 1, 5, 1000, 1003}) {
+    std::vector<GF> secret(m);
+    fill_pseudo_random(secret);
+
+    std::vector<Share> shares =
+        split_packed(secret, 4, 6, 10, fill_pseudo_random);
+    ASSERT_EQ(shares.size(), 10);
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_EQ(shares[i].x, GF(i + 1));
+      EXPECT_EQ(shares[i].ys.size(), (m + 3) / 4);
+    }
+
+    // Any 6 shares reconstruct the secret.
+    std::shuffle(shares.begin(), shares.end(), rng);
+    EXPECT_EQ(reconstruct_packed(std::span(shares).first(6), 4, 6, m),
+              secret);
+    EXPECT_EQ(reconstruct_packed(shares, 4, 6, m), secret);
+
+    // Fewer shares don't determine the polynomials.
+    EXPECT_THROW(reconstruct_packed(std::span(shares).first(5), 4, 6, m),
+                 std::runtime_error);
+  }
+
+  // Interpolating the shares gives the blocks at the secret points.
+  std::vector<GF> secret(8);
+  fill_pseudo_random(secret);
+  const std::vector<Share> shares =
+      split_packed(secret, 2, 3, 3, fill_pseudo_random);
+  EXPECT_TRUE(std::ranges::equal(
+      interpolate(shares, packed_secret_x(1)).ys, std::span(secret).last(4)));
+
+  EXPECT_THROW(split_packed(secret, 0, 3, 5, fill_pseudo_random),
+               std::runtime_error);
+  EXPECT_THROW(split_packed(secret, 3, 3, 5, fill_pseudo_random),
+               std::runtime_error);
+  EXPECT_THROW(split_packed(secret, 2, 3, 2, fill_pseudo_random),
+               std::runtime_error);
+  EXPECT_THROW(split_packed(secret, 2, 3, 254, fill_pseudo_random),
+               std::runtime_error);
+  EXPECT_THROW(reconstruct_packed(shares, 2, 3, 9), std::runtime_error);
+  EXPECT_THROW(reconstruct_packed(shares, 0, 3, 8), std::runtime_error);
+  EXPECT_THROW(reconstruct_packed(shares, 3, 3, 8), std::runtime_error);
+  EXPECT_THROW(reconstruct_packed(std::span(shares).first(2), 2, 3, 8),
+               std::runtime_error);
+}
+
+TEST(GF256, Refresh) {
+  // Accumulating dot product.
+  std::vector<GF> a(100), b(100), c(100);
+  fill_pseudo_random(a);
+  fill_pseudo_random(b);
+  fill_pseudo_random(c);
+  std::vector<GF> want = c;
+  for (size_t i = 0; i < want.size(); ++i) {
+    want[i] += GF(3) * a[i] + GF(7) * b[i];
+  }
+
+  const std::vector<GF> cs = {GF(3), GF(7)};
+  const std::vector<std::span<const GF>> srcs = {a, b};
+  dot_add(c, cs, srcs);
+  EXPECT_EQ(c, want);
+
+  // Use a size larger than the refresh window.
+  for (const size_t m : {size_t(0), size_t(1000), size_t(100000)}) {
+    std::vector<GF> secret(m);
+    fill_pseudo_random(secret);
+    const std::vector<Share> old_shares =
+        split(secret, 3, 5, fill_pseudo_random);
+
+    std::vector<Share> shares = old_shares;
+    refresh(shares, 3, fill_pseudo_random);
+    for (int i = 0; i < 5; ++i) {
+      EXPECT_EQ(shares[i].x, old_shares[i].x);
+      if (m > 0) {
+        EXPECT_NE(shares[i].ys, old_shares[i].ys);
+      }
+    }
+
+    // Any 3 refreshed shares still reconstruct the secret, but not together
+    // with old shares.
+    const std::vector<Share> some = {shares[4], shares[0], shares[2]};
+    EXPECT_EQ(interpolate(some, GF(0)).ys, secret);
+    const std::vector<Share> mixed = {shares[4], old_shares[0], shares[2]};
+    if (m > 0) {
+      EXPECT_NE(interpolate(mixed, GF(0)).ys, secret);
+    }
+  }
+
+  std::vector<Share> shares = {{GF(1), {GF(1)}}, {GF(2), {}}};
+  EXPECT_THROW(refresh(shares, 2, fill_pseudo_random), std::runtime_error);
+  shares[1] = {GF(0), {GF(2)}};
+  EXPECT_THROW(refresh(shares, 2, fill_pseudo_random), std::runtime_error);
+  EXPECT_THROW(refresh(shares, 1, fill_pseudo_random), std::runtime_error);
+}
+
+TEST(GF256, Reshare) {
+  std::mt19937 rng(std::random_device{}());
+
+  std::vector<GF> secret(10000);
+  fill_pseudo_random(secret);
+  const std::vector<Share> shares = split(secret, 3, 5, fill_pseudo_random);
+  const std::vector<Share> old = {shares[3], shares[0], shares[4]};
+
+  // From a (3, 5) sharing to a (4, 6) sharing with other x values.
+  const std::vector<GF> xs = {GF(10), GF(11), GF(12), GF(13), GF(14), GF(15)};
+  std::vector<Share> fresh = reshare(old, 4, xs, fill_pseudo_random);
+  ASSERT_EQ(fresh.size(), 6);
+  for (size_t i = 0; i < xs.size(); ++i) EXPECT_EQ(fresh[i].x, xs[i]);
+
+  std::shuffle(fresh.begin(), fresh.end(), rng);
+  EXPECT_EQ(interpolate(std::span(fresh).first(4), GF(0)).ys, secret);
+  EXPECT_EQ(interpolate(std::span(fresh).last(4), GF(0)).ys, secret);
+  EXPECT_NE(interpolate(std::span(fresh).first(3), GF(0)).ys, secret);
+
+  // To a lower threshold.
+  const std::vector<Share> pair = reshare(shares, 2, xs, fill_pseudo_random);
+  EXPECT_EQ(interpolate(std::span(pair).subspan(2, 2), GF(0)).ys, secret);
+
+  const std::vector<GF> dup = {GF(1), GF(2), GF(1)};
+  EXPECT_THROW(reshare(old, 2, dup, fill_pseudo_random), std::runtime_error);
+  EXPECT_THROW(reshare(old, 3, dup, fill_pseudo_random), std::runtime_error);
+  const std::vector<GF> late_dup = {GF(1), GF(2), GF(3), GF(4), GF(3)};
+  EXPECT_THROW(reshare(old, 2, late_dup, fill_pseudo_random),
+               std::runtime_error);
+  EXPECT_THROW(reshare(old, 3, late_dup, fill_pseudo_random),
+               std::runtime_error);
+  const std::vector<GF> zero = {GF(1), GF(0), GF(2)};
+  EXPECT_THROW(reshare(old, 2, zero, fill_pseudo_random), std::runtime_error);
+  EXPECT_THROW(reshare(old, 4, zero, fill_pseudo_random), std::runtime_error);
+  EXPECT_THROW(reshare(std::span(old).first(1), 2, xs, fill_pseudo_random),
+               std::runtime_error);
+}
+
+TEST(GF256, Interleave) {
+  // Partial and complete blocks of 16 rows and 16 columns.
+  for (const std::size_t n : {1, 3, 16, 21, 40}) {
+    for (const std::size_t m : {0, 7, 16, 100}) {
+      std::vector<std::vector<GF>> rows(n, std::vector<GF>(m));
+      std::vector<std::span<const GF>> srcs;
+      for (std::vector<GF>& row : rows) {
+        fill_pseudo_random(row);
+        srcs.push_back(row);
+      }
+
+      std::vector<GF> plane(n * m);
+      interleave(srcs, plane);
+      for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < m; ++j) {
+          ASSERT_EQ(plane[j * n + i], rows[i][j]) << n << " " << m;
+        }
+      }
+
+      std::vector<std::vector<GF>> back(n, std::vector<GF>(m));
+      std::vector<std::span<GF>> dsts(back.begin(), back.end());
+      deinterleave(plane, dsts);
+      EXPECT_EQ(back, rows) << n << " " << m;
+    }
+  }
+}
+
+TEST(GF256, InterleavedShares) {
+  // Several tiles, the last one partial.
+  std::vector<GF> secret(10000);
+  fill_pseudo_random(secret);
+  const InterleavedShares shares =
+      split_interleaved(secret, 3, 5, fill_pseudo_random);
+  ASSERT_EQ(shares.xs.size(), 5);
+  ASSERT_EQ(shares.size(), secret.size());
+  EXPECT_EQ(shares.column(42).size(), 5);
+
+  const std::vector<Share> rows = deinterleave(shares);
+  EXPECT_EQ(interleave(rows), shares);
+  EXPECT_EQ(interpolate(std::span(rows).last(3), GF(0)).ys, secret);
+
+  const std::vector<Share> some = {rows[4], rows[0], rows[2]};
+  const InterleavedShares three = interleave(some);
+  EXPECT_EQ(interpolate_interleaved(three, GF(0)).ys, secret);
+  EXPECT_EQ(interpolate_interleaved(three, GF(2)), rows[1]);
+
+  const std::vector<GF> empty;
+  EXPECT_EQ(split_interleaved(empty, 2, 3, fill_pseudo_random).size(), 0);
+  EXPECT_THROW(split_interleaved(secret, 4, 3, fill_pseudo_random),
+               std::runtime_error);
+  EXPECT_THROW(interleave(std::vector<Share>{rows[0], Share{GF(9), {}}}),
+               std::runtime_error);
+  EXPECT_THROW(interpolate_interleaved(interleave(std::span(rows).first(1)),
+                                       GF(0)),
+               std::runtime_error);
+}
+
+TEST(GF256, PmrInterpolate) {
+  std::vector<GF> secret(1000);
+  fill_pseudo_random(secret);
+  const std::vector<Share> shares = split(secret, 3, 5, fill_pseudo_random);
+  std::vector<PmrShare> some;
+  for (const int i : {4, 0, 2}) {
+    some.push_back({shares[i].x, {shares[i].ys.begin(), shares[i].ys.end()}});
+  }
+
+  // Everything is allocated from the arena, which has no upstream resource.
+  std::array<std::byte, 3000> buffer;
+  std::pmr::monotonic_buffer_resource arena(
+      buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+  const PmrShare r = interpolate(some, GF(0), &arena);
+  EXPECT_TRUE(std::ranges::equal(r.ys, secret));
+  EXPECT_EQ(r.ys.get_allocator().resource(), &arena);
+
+  const PmrShare s = interpolate(some, GF(2), &arena);
+  EXPECT_EQ(s.x, GF(2));
+  EXPECT_TRUE(std::ranges::equal(s.ys, shares[1].ys));
+
+  // The arena is exhausted.
+  EXPECT_THROW(interpolate(some, GF(0), &arena), std::bad_alloc);
+
+  EXPECT_THROW(interpolate(std::span(some).first(1), GF(0), &arena),
+               std::runtime_error);
+}
+
+TEST(GF256, RegionExpr) {
+  // Several tiles, the last one partial.
+  constexpr size_t m = 10000;
+  std::vector<GF> x(m), y(m), z(m), dst(m);
+  fill_pseudo_random(x);
+  fill_pseudo_random(y);
+  fill_pseudo_random(z);
+  fill_pseudo_random(dst);
+  const GF a(3), b(0x53), c(0xCA), d(7);
+
+  const auto expected = [&](size_t j) {
+    return a * x[j] + b * y[j] + d * (c * z[j] + x[j]);
+  };
+
+  const auto e = a * x + y * b + d * (c * z + GF(1) * x);
+  static_assert(std::is_same_v<decltype(e), const RegionExpr<4>>);
+  region(dst) = e;
+  for (size_t j = 0; j < m; ++j) ASSERT_EQ(dst[j], expected(j)) << j;
+
+  std::vector<GF> sum = dst;
+  region(sum) += a * x - b * y;
+  for (size_t j = 0; j < m; ++j) {
+    ASSERT_EQ(sum[j], dst[j] + a * x[j] + b * y[j]) << j;
+  }
+
+  // The destination is also a source, possibly several times.
+  const std::vector<GF> old = dst;
+  region(dst) = b * dst + c * z + a * dst;
+  for (size_t j = 0; j < m; ++j) {
+    ASSERT_EQ(dst[j], (a + b) * old[j] + c * z[j]) << j;
+  }
+
+  dst = old;
+  region(dst) += b * z + c * dst;
+  for (size_t j = 0; j < m; ++j) {
+    ASSERT_EQ(dst[j], old[j] + b * z[j] + c * old[j]) << j;
+  }
+
+  // Adding the destination to itself clears it.
+  dst = old;
+  region(dst) = GF(1) * dst;
+  EXPECT_EQ(dst, old);
+  region(dst) -= GF(1) * dst;
+  EXPECT_EQ(dst, std::vector<GF>(m));
+}
+
+TEST(GF256, InterpolatedView) {
+  static_assert(std::ranges::random_access_range<InterpolatedView>);
+  static_assert(std::ranges::sized_range<InterpolatedView>);
+
+  // Several chunks, the last one partial.
+  std::vector<GF> secret(10 * InterpolatedView::chunk_size + 123);
+  fill_pseudo_random(secret);
+  const std::vector<Share> shares = split(secret, 3, 5, fill_pseudo_random);
+  const std::vector<Share> some = {shares[4], shares[0], shares[2]};
+
+  // Only the chunks accessed are computed.
+  const InterpolatedView view(some);
+  EXPECT_EQ(view.size(), secret.size());
+  EXPECT_EQ(view[0], secret[0]);
+  EXPECT_EQ(view[100], secret[100]);
+  EXPECT_EQ(view.computed_chunks(), 1);
+  EXPECT_EQ(view[secret.size() - 1], secret.back());
+  EXPECT_EQ(view[5], secret[5]);
+  EXPECT_EQ(view.computed_chunks(), 2);
+
+  auto it = view.begin();
+  EXPECT_EQ(it[7000], secret[7000]);
+  it += 9000;
+  EXPECT_EQ(*it, secret[9000]);
+  EXPECT_EQ(*--it, secret[8999]);
+  EXPECT_EQ(view.end() - it, secret.size() - 8999);
+  EXPECT_LT(it, view.end());
+
+  // Whole iterations, forward and backward.
+  EXPECT_TRUE(std::ranges::equal(view, secret));
+  EXPECT_TRUE(std::ranges::equal(view | std::views::reverse,
+                                 secret | std::views::reverse));
+
+  // Interpolation at the x value of a missing share.
+  const InterpolatedView other(some, GF(2));
+  EXPECT_EQ(other.dest_x(), GF(2));
+  EXPECT_TRUE(std::ranges::equal(other, shares[1].ys));
+
+  const std::vector<Share> bad = {shares[0], Share{GF(9), {}}};
+  EXPECT_THROW(InterpolatedView{bad}, std::runtime_error);
+  EXPECT_THROW(InterpolatedView(std::span(some).first(1)), std::runtime_error);
+}
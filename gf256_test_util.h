@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "gf256.h"
+
+// Helpers shared by the tests.
+
+// Fills `out` with pseudo-random values. Each thread has its own generator, so
+// that it can be used as the random function of concurrent splits.
+inline void fill_pseudo_random(std::span<GF> out) {
+  thread_local std::mt19937 rng(std::random_device{}());
+  std::uniform_int_distribution<int> dist(0, 255);
+  for (GF& y : out) y = GF(dist(rng));
+}
+
+// Gets `m` pseudo-random values.
+inline std::vector<GF> random_bytes(std::size_t m) {
+  std::vector<GF> v(m);
+  fill_pseudo_random(v);
+  return v;
+}
@@ -0,0 +1,526 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "gf256_io.h"
+
+// Minimal wrapper around a Linux io_uring instance, using the raw system calls.
+class IoUring {
+ public:
+  // Creates an io_uring instance with room for at least `entries` submissions.
+  // Throws: std::system_error if io_uring is not available.
+  explicit IoUring(unsigned entries) {
+    io_uring_params p = {};
+    fd_ = ::syscall(__NR_io_uring_setup, entries, &p);
+    if (fd_ < 0) throw_errno("Cannot set up io_uring");
+
+    try {
+      map_rings(p);
+    } catch (...) {
+      release();
+      throw;
+    }
+  }
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  ~IoUring() { release(); }
+
+  // Registers buffers, so that they can be used by fixed read and write
+  // operations.
+  // Throws: std::system_error if the buffers cannot be registered.
+  void register_buffers(std::span<const iovec> iovs) const {
+    if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS,
+                  iovs.data(), iovs.size()) < 0) {
+      throw_errno("Cannot register io_uring buffers");
+    }
+  }
+
+  // Registers a table of files, so that operations can refer to them by their
+  // index in this table. Entries can be -1 and updated later.
+  // Throws: std::system_error if the files cannot be registered.
+  void register_files(std::span<const int> fds) const {
+    if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_FILES,
+                  fds.data(), fds.size()) < 0) {
+      throw_errno("Cannot register io_uring files");
+    }
+  }
+
+  // Replaces the registered files starting at index `offset`.
+  // Throws: std::system_error if the files cannot be updated.
+  void update_files(unsigned offset, std::span<const int> fds) const {
+    io_uring_files_update u = {};
+    u.offset = offset;
+    u.fds = reinterpret_cast<std::uintptr_t>(fds.data());
+    if (::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_FILES_UPDATE,
+                  &u, fds.size()) < 0) {
+      throw_errno("Cannot update io_uring files");
+    }
+  }
+
+  // Gets a cleared submission queue entry to fill, or nullptr if the submission
+  // queue is full. The entry is submitted by the next call to `submit`.
+  io_uring_sqe* get_sqe() noexcept {
+    const std::uint32_t head =
+        std::atomic_ref(*sq_head_).load(std::memory_order_acquire);
+    if (sq_local_tail_ - head >= sq_entries_) return nullptr;
+
+    const std::uint32_t i = sq_local_tail_++ & sq_mask_;
+    io_uring_sqe* const sqe = &sqes_[i];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[i] = i;
+    return sqe;
+  }
+
+  // Submits the pending entries, and waits for at least `wait` completions.
+  //
+  // The kernel may take fewer entries than offered, in which case it returns
+  // without waiting, and the remaining entries are offered again. The wait thus
+  // only happens on the call submitting the last entries.
+  //
+  // Throws: std::system_error if the entries cannot be submitted.
+  void submit(unsigned wait = 0) {
+    std::atomic_ref(*sq_tail_).store(sq_local_tail_, std::memory_order_release);
+    if (sq_local_tail_ == sq_submitted_ && wait == 0) return;
+    while (true) {
+      const unsigned n = sq_local_tail_ - sq_submitted_;
+      const long r = ::syscall(__NR_io_uring_enter, fd_, n, wait,
+                               wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+      if (r < 0) {
+        if (errno == EINTR) continue;
+        throw_errno("Cannot submit io_uring entries");
+      }
+
+      sq_submitted_ += r;
+      if (sq_submitted_ == sq_local_tail_) return;
+    }
+  }
+
+  // Pops a completion queue entry. Returns false if there is none.
+  bool pop(io_uring_cqe& cqe) noexcept {
+    const std::uint32_t head = *cq_head_;
+    if (head == std::atomic_ref(*cq_tail_).load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    cqe = cqes_[head & cq_mask_];
+    std::atomic_ref(*cq_head_).store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  // Maps the submission and completion rings.
+  void map_rings(const io_uring_params& p) {
+    sq_size_ = p.sq_off.array + p.sq_entries * sizeof(std::uint32_t);
+    cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    single_mmap_ = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap_) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+
+    sq_ = map(sq_size_, IORING_OFF_SQ_RING);
+    cq_ = single_mmap_ ? sq_ : map(cq_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+
+    const auto field = [](void* base, std::uint32_t offset) {
+      return reinterpret_cast<std::uint32_t*>(static_cast<std::byte*>(base) +
+                                              offset);
+    };
+
+    sq_head_ = field(sq_, p.sq_off.head);
+    sq_tail_ = field(sq_, p.sq_off.tail);
+    sq_mask_ = *field(sq_, p.sq_off.ring_mask);
+    sq_array_ = field(sq_, p.sq_off.array);
+    sq_entries_ = p.sq_entries;
+    cq_head_ = field(cq_, p.cq_off.head);
+    cq_tail_ = field(cq_, p.cq_off.tail);
+    cq_mask_ = *field(cq_, p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(static_cast<std::byte*>(cq_) +
+                                            p.cq_off.cqes);
+  }
+
+  // Unmaps the rings and closes the io_uring instance.
+  void release() noexcept {
+    if (sqes_) ::munmap(sqes_, sqes_size_);
+    if (cq_ && cq_ != sq_) ::munmap(cq_, cq_size_);
+    if (sq_) ::munmap(sq_, sq_size_);
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  void* map(std::size_t size, std::uint64_t offset) const {
+    void* const p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd_, offset);
+    if (p == MAP_FAILED) throw_errno("Cannot map io_uring");
+    return p;
+  }
+
+  int fd_ = -1;
+  bool single_mmap_ = false;
+  void* sq_ = nullptr;
+  void* cq_ = nullptr;
+  io_uring_sqe* sqes_ = nullptr;
+  std::size_t sq_size_ = 0;
+  std::size_t cq_size_ = 0;
+  std::size_t sqes_size_ = 0;
+  std::uint32_t* sq_head_ = nullptr;
+  std::uint32_t* sq_tail_ = nullptr;
+  std::uint32_t* sq_array_ = nullptr;
+  std::uint32_t sq_mask_ = 0;
+  std::uint32_t sq_entries_ = 0;
+  std::uint32_t sq_local_tail_ = 0;
+  std::uint32_t sq_submitted_ = 0;
+  std::uint32_t* cq_head_ = nullptr;
+  std::uint32_t* cq_tail_ = nullptr;
+  std::uint32_t cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+};
+
+// Reconstruction job: the share files to combine, and the file to write the
+// reconstructed secret to.
+struct ReconstructJob {
+  std::vector<std::string> inputs;
+  std::string output;
+};
+
+// Pipelined engine reconstructing many files from share files, like
+// `combine_files` does for a single file.
+//
+// The files are processed in windows. Up to `depth` windows, possibly from
+// different jobs, are in flight at any time. The reads of the upcoming windows
+// and the writes of the reconstructed windows are issued asynchronously
+// through io_uring, while the current window is being verified and
+// interpolated. The windows use buffers registered with io_uring, and the
+// files are accessed through the io_uring table of registered files.
+class ReconstructEngine {
+ public:
+  // Creates an engine for jobs combining up to `max_shares` share files.
+  // Throws: std::system_error if io_uring is not available.
+  explicit ReconstructEngine(int max_shares, std::size_t depth = 4,
+                             std::size_t window_size = io_window_size)
+      : max_shares_(max_shares),
+        window_size_(window_size),
+        slot_stride_(max_shares + 1),
+        buffers_(depth * slot_stride_ * window_size),
+        ring_(depth * slot_stride_),
+        slots_(depth) {
+    for (Slot& slot : slots_) slot.done.resize(slot_stride_);
+    if (max_shares < 2) throw std::runtime_error("Too few shares");
+    if (depth == 0 || window_size == 0) {
+      throw std::runtime_error("Invalid engine parameters");
+    }
+
+    // Registered buffers and files are optimizations. Fall back to regular
+    // operations if they are not available, for example because of the
+    // locked memory limit.
+    try {
+      const iovec iov = {buffers_.span().data(), buffers_.span().size()};
+      ring_.register_buffers({&iov, 1});
+      fixed_buffers_ = true;
+    } catch (const std::system_error&) {
+    }
+
+    try {
+      ring_.register_files(std::vector<int>(depth * slot_stride_, -1));
+      fixed_files_ = true;
+    } catch (const std::system_error&) {
+    }
+  }
+
+  // Indicates whether io_uring accepted the registered buffers and files.
+  bool uses_fixed_buffers() const noexcept { return fixed_buffers_; }
+  bool uses_fixed_files() const noexcept { return fixed_files_; }
+
+  // Runs the given jobs. Each job must satisfy the preconditions of
+  // `combine_files`, and must have at most `max_shares` inputs.
+  // Throws: std::runtime_error if a job fails, after waiting for all the
+  // operations in flight.
+  void run(std::span<const ReconstructJob> jobs) {
+    next_job_ = jobs.begin();
+    end_job_ = jobs.end();
+    try {
+      loop();
+    } catch (...) {
+      drain();
+      current_ = nullptr;
+      active_.clear();
+      throw;
+    }
+  }
+
+ private:
+  // Job being processed.
+  struct Job {
+    std::vector<ShareFileReader> readers;
+    File out;
+    std::vector<GF> cs;
+    std::vector<int> fds;
+    std::size_t size = 0;
+    std::size_t window = 0;
+    std::size_t next_pos = 0;
+    int windows_in_flight = 0;
+  };
+
+  // Window being processed.
+  struct Slot {
+    Job* job = nullptr;
+    std::size_t pos = 0;
+    std::size_t len = 0;
+    int pending = 0;
+
+    // Number of bytes already transferred for each file of the job, the output
+    // file being last. io_uring can complete a read or a write partially.
+    std::vector<std::size_t> done;
+  };
+
+  // Value of `user_data` identifying the write of a slot.
+  static constexpr std::uint64_t write_op = 0xFFFF;
+
+  // Buffer of the share `i` of slot `s`. The last buffer of each slot holds
+  // the reconstructed values.
+  std::span<GF> buffer(std::size_t s, std::size_t i) const noexcept {
+    return buffers_.span().subspan((s * slot_stride_ + i) * window_size_,
+                                   window_size_);
+  }
+
+  // Opens the next job. Returns false if there is none.
+  bool open_job() {
+    while (next_job_ != end_job_) {
+      const ReconstructJob& j = *next_job_++;
+      if (int(j.inputs.size()) > max_shares_) {
+        throw std::runtime_error("Too many shares");
+      }
+
+      Job& job = active_.emplace_back();
+      std::vector<GF> xs;
+      job.readers.reserve(j.inputs.size());
+      for (const std::string& path : j.inputs) {
+        xs.push_back(job.readers.emplace_back(path).header().x);
+        job.fds.push_back(job.readers.back().file().fd());
+      }
+
+      if (job.readers.empty()) throw std::runtime_error("Too few shares");
+      const ShareFileHeader& h = job.readers.front().header();
+      if (int(xs.size()) < std::max(h.threshold, 2)) {
+        throw std::runtime_error("Too few shares");
+      }
+
+      for (const ShareFileReader& r : job.readers) {
+        if (r.header().size != h.size) {
+          throw std::runtime_error(
+              "All the shares must have the same number of y values");
+        }
+
+        if (r.header().threshold != h.threshold ||
+            r.header().chunk_size != h.chunk_size) {
+          throw std::runtime_error("Shares from different splits");
+        }
+      }
+
+      if (h.chunk_size > window_size_) {
+        throw std::runtime_error("Chunks larger than engine windows");
+      }
+
+      job.cs = lagrange_coefficients(xs, GF(0));
+      job.size = h.size;
+      job.window = window_size_ - window_size_ % h.chunk_size;
+      job.out = File(j.output, O_RDWR | O_CREAT | O_TRUNC);
+      job.out.resize(job.size);
+      job.fds.push_back(job.out.fd());
+
+      if (job.size > 0) {
+        current_ = &job;
+        return true;
+      }
+
+      active_.pop_back();
+    }
+
+    return false;
+  }
+
+  // Starts reading the next window into the free slot `s`. Returns false if
+  // there is no more window to read.
+  bool start_window(std::size_t s) {
+    if (!current_ && !open_job()) return false;
+
+    Job& job = *current_;
+    Slot& slot = slots_[s];
+    slot.job = &job;
+    slot.pos = job.next_pos;
+    slot.len = std::min(job.window, job.size - job.next_pos);
+    slot.pending = job.readers.size();
+    job.next_pos += slot.len;
+    ++job.windows_in_flight;
+    if (job.next_pos == job.size) current_ = nullptr;
+    std::fill(slot.done.begin(), slot.done.end(), 0);
+
+    if (fixed_files_) ring_.update_files(s * slot_stride_, job.fds);
+
+    for (std::size_t i = 0; i < job.readers.size(); ++i) {
+      prepare_remaining(s, i);
+    }
+
+    return true;
+  }
+
+  // Prepares the read of the share `id` of slot `s`, or its write if `id` is
+  // `write_op`, starting after the bytes already transferred.
+  void prepare_remaining(std::size_t s, std::uint64_t id) {
+    const Slot& slot = slots_[s];
+    const Job& job = *slot.job;
+    const std::size_t k = job.readers.size();
+    if (id == write_op) {
+      const std::size_t done = slot.done[k];
+      prepare(s, k, IORING_OP_WRITE, slot.pos + done,
+              buffer(s, max_shares_).subspan(done, slot.len - done), write_op);
+    } else {
+      const std::size_t done = slot.done[id];
+      prepare(s, id, IORING_OP_READ,
+              job.readers[id].header().data_offset + slot.pos + done,
+              buffer(s, id).subspan(done, slot.len - done), id);
+    }
+  }
+
+  // Prepares a read or write operation of the file `f` of slot `s`.
+  void prepare(std::size_t s, std::size_t f, std::uint8_t op,
+               std::size_t offset, std::span<GF> buf, std::uint64_t id) {
+    io_uring_sqe* sqe = ring_.get_sqe();
+    if (!sqe) {
+      ring_.submit();
+      sqe = ring_.get_sqe();
+      assert(sqe);
+    }
+
+    const Slot& slot = slots_[s];
+    if (fixed_files_) {
+      sqe->fd = s * slot_stride_ + f;
+      sqe->flags = IOSQE_FIXED_FILE;
+    } else {
+      sqe->fd = slot.job->fds[f];
+    }
+
+    if (fixed_buffers_) {
+      op = op == IORING_OP_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+      sqe->buf_index = 0;
+    }
+
+    sqe->opcode = op;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(buf.data());
+    sqe->len = buf.size();
+    sqe->user_data = (s << 16) | id;
+    ++in_flight_;
+  }
+
+  // Handles the completion of an operation.
+  void complete(const io_uring_cqe& cqe) {
+    --in_flight_;
+    const std::size_t s = cqe.user_data >> 16;
+    const std::uint64_t id = cqe.user_data & 0xFFFF;
+    Slot& slot = slots_[s];
+    if (cqe.res < 0) {
+      throw std::system_error(-cqe.res, std::generic_category(),
+                              id == write_op ? "Cannot write file"
+                                             : "Cannot read file");
+    }
+
+    if (cqe.res == 0) {
+      throw std::runtime_error(id == write_op ? "Short write"
+                                              : "Unexpected end of file");
+    }
+
+    Job& job = *slot.job;
+    std::size_t& done = slot.done[id == write_op ? job.readers.size() : id];
+    done += cqe.res;
+    if (done < slot.len) {
+      prepare_remaining(s, id);
+      return;
+    }
+
+    if (id == write_op) {
+      slot.job = nullptr;
+      free_.push_back(s);
+      if (--job.windows_in_flight == 0 && &job != current_ &&
+          job.next_pos == job.size) {
+        active_.remove_if([&job](const Job& j) { return &j == &job; });
+      }
+      return;
+    }
+
+    if (--slot.pending > 0) return;
+
+    // All the shares of the window have been read.
+    const std::size_t k = job.readers.size();
+    std::vector<std::span<const GF>> srcs;
+    for (std::size_t i = 0; i < k; ++i) {
+      srcs.push_back(buffer(s, i).first(slot.len));
+      job.readers[i].verify(srcs.back(), slot.pos);
+    }
+
+    const std::span<GF> dest = buffer(s, max_shares_).first(slot.len);
+    dot(dest, job.cs, srcs);
+    prepare_remaining(s, write_op);
+  }
+
+  void loop() {
+    free_.clear();
+    for (std::size_t s = slots_.size(); s-- > 0;) free_.push_back(s);
+
+    while (true) {
+      while (!free_.empty() && start_window(free_.back())) free_.pop_back();
+      if (in_flight_ == 0) break;
+
+      ring_.submit(1);
+      io_uring_cqe cqe;
+      while (ring_.pop(cqe)) complete(cqe);
+    }
+  }
+
+  // Waits for all the operations in flight, ignoring their results.
+  void drain() noexcept {
+    try {
+      while (in_flight_ > 0) {
+        ring_.submit(1);
+        io_uring_cqe cqe;
+        while (ring_.pop(cqe)) --in_flight_;
+      }
+    } catch (const std::system_error&) {
+    }
+  }
+
+  const int max_shares_;
+  const std::size_t window_size_;
+  const std::size_t slot_stride_;
+  const PageBuffer buffers_;
+  IoUring ring_;
+  bool fixed_buffers_ = false;
+  bool fixed_files_ = false;
+  std::vector<Slot> slots_;
+  std::vector<std::size_t> free_;
+  std::list<Job> active_;
+  Job* current_ = nullptr;
+  std::size_t in_flight_ = 0;
+  std::span<const ReconstructJob>::iterator next_job_;
+  std::span<const ReconstructJob>::iterator end_job_;
+};
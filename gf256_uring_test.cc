@@ -0,0 +1,99 @@
+#include "gf256_uring.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "gf256_test_util.h"
+
+namespace {
+
+// Temporary directory deleted at the end of the test.
+class TempDir {
+ public:
+  TempDir() {
+    std::string tmpl =
+        (std::filesystem::temp_directory_path() / "gf256_test.XXXXXX");
+    if (!::mkdtemp(tmpl.data())) throw_errno("Cannot create temp dir");
+    path_ = tmpl;
+  }
+
+  ~TempDir() { std::filesystem::remove_all(path_); }
+
+  std::string operator/(const std::string& name) const {
+    return path_ / name;
+  }
+
+ private:
+  std::filesystem::path path_;
+};
+
+std::vector<GF> read_file(const std::string& path) {
+  const File f(path, O_RDONLY);
+  std::vector<GF> data(f.size());
+  f.read_at(std::as_writable_bytes(std::span(data)), 0);
+  return data;
+}
+
+// Creates an engine, or returns nothing if io_uring is not available.
+std::unique_ptr<ReconstructEngine> make_engine(int max_shares, size_t depth,
+                                               size_t window_size) {
+  try {
+    return std::make_unique<ReconstructEngine>(max_shares, depth,
+                                               window_size);
+  } catch (const std::system_error&) {
+    return nullptr;
+  }
+}
+
+}  // namespace
+
+TEST(GF256Uring, ReconstructEngine) {
+  // Use small windows so that each job spans several windows.
+  const std::unique_ptr<ReconstructEngine> engine =
+      make_engine(4, 3, 2 * share_file_chunk_size);
+  if (!engine) GTEST_SKIP() << "io_uring is not available";
+
+  const TempDir dir;
+  std::vector<std::vector<GF>> secrets;
+  std::vector<ReconstructJob> jobs;
+  const size_t sizes[] = {0, 1, 5 * share_file_chunk_size + 3, 1000,
+                          2 * share_file_chunk_size};
+  for (int i = 0; i < 5; ++i) {
+    const std::string name = dir / ("secret" + std::to_string(i));
+    const std::vector<GF>& secret =
+        secrets.emplace_back(random_bytes(sizes[i]));
+    {
+      const File f(name, O_WRONLY | O_CREAT | O_TRUNC);
+      f.write_at(std::as_bytes(std::span(secret)), 0);
+    }
+
+    const std::vector<std::string> shares = {name + ".1", name + ".2",
+                                             name + ".3", name + ".4"};
+    split_file(name, 2 + i % 3, shares);
+    jobs.push_back({{shares.begin(), shares.begin() + 2 + i % 3},
+                    name + ".out"});
+  }
+
+  engine->run(jobs);
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(read_file(jobs[i].output), secrets[i]);
+  }
+
+  // The engine can be reused, and reports errors.
+  jobs[1].inputs.pop_back();
+  EXPECT_THROW(engine->run(jobs), std::runtime_error);
+
+  jobs[1].inputs = {jobs[1].inputs[0], dir / "missing"};
+  EXPECT_THROW(engine->run(jobs), std::runtime_error);
+
+  jobs.erase(jobs.begin() + 1);
+  engine->run(jobs);
+  EXPECT_EQ(read_file(jobs[3].output), secrets[4]);
+}